@@ -7,47 +7,32 @@
 /****************************************************/
 
 #include "globals.h"
+#include "util.h"
 #include "symtab.h"
+#include "flat.h"
 #include "analyze.h"
 
 /* counter for variable memory locations */
 static int location = 0;
 
-/* Procedure traverse is a generic recursive
- * syntax tree traversal routine:
- * it applies preProc in preorder and postProc
- * in postorder to tree pointed to by t
+/* insere o identificador atom na tabela de símbolos: na primeira
+ocorrência com uma nova localização de memória, nas demais apenas
+acrescenta o número da linha. Retorna a localização de memória do
+identificador, que é guardada no nó para a geração de código
  */
-static void traverse(TreeNode *t,
-                     void (*preProc)(TreeNode *),
-                     void (*postProc)(TreeNode *))
+static int bindName(int atom, int lineno)
 {
-  if (t != NULL)
-  {
-    preProc(t);
-    {
-      int i;
-      for (i = 0; i < MAXCHILDREN; i++)
-        traverse(t->child[i], preProc, postProc);
-    }
-    postProc(t);
-    traverse(t->sibling, preProc, postProc);
+  int loc = st_lookupAtom(atom);
+  if (loc == -1) // se o identificador ainda não estiver na TS
+  { // insere o nome da variável, o número da linha que a variável está e 
+    // a localização da variável na tabela de simbolos
+    loc = location++;
+    st_insertAtom(atom, lineno, loc);
   }
-}
-
-/* não faz nada apenas serve para ser 
-utilizada como argumento da função traverse, 
-quando colocada no segundo argumento indica que a árvore 
-não terá uma função para percorre-la em pre-ordem
-e quando usada como terceiro argumento, significa 
-que não será percorrida em pós-ordem.
- */
-static void nullProc(TreeNode *t)
-{
-  if (t == NULL)
-    return;
-  else
-    return;
+  else // se já estiver na tabela
+    // adiciona o número da linha onde a variável está aparecendo novamente no código fonte
+    st_insertAtom(atom, lineno, 0);
+  return loc;
 }
 
 /*insere identificadores que estejam em 
@@ -62,14 +47,7 @@ static void insertNode(TreeNode *t)
     {
     case AssignK:
     case ReadK:
-      if (st_lookup(t->attr.name) == -1)// se o identificador ainda não estiver na TS
-           // Insere o identificador pela linha abaixo 
-        st_insert(t->attr.name, t->lineno, location++);
-        // insere o nome da variável, o número da linha que a variável está e 
-        // a localização da variável na tabela de simbolos
-      else // se já estiver na tabela
-        // adiciona o número da linha onde a variável está aparecendo novamente no código fonte
-        st_insert(t->attr.name, t->lineno, 0);
+      t->memloc = bindName(t->attr.atom, t->lineno);
       break;
     default:
       break;
@@ -79,13 +57,7 @@ static void insertNode(TreeNode *t)
     switch (t->kind.exp)
     {
     case IdK:
-      if (st_lookup(t->attr.name) == -1)
-        /* not yet in table, so treat as new definition */
-        st_insert(t->attr.name, t->lineno, location++);
-      else
-        /* already in table, so ignore location,
-             add line number of use only */
-        st_insert(t->attr.name, t->lineno, 0);
+      t->memloc = bindName(t->attr.atom, t->lineno);
       break;
     default:
       break;
@@ -96,78 +68,120 @@ static void insertNode(TreeNode *t)
   }
 }
 
-/* constroi a tabela de símbolos de acordo com 
-a árvore sintática passada
+/* Na análise combinada os erros de tipo são guardados e só emitidos
+depois da tabela de símbolos, para que a listagem fique igual à da
+análise em duas passadas
  */
-void buildSymtab(TreeNode *syntaxTree)
+typedef struct
 {
-  traverse(syntaxTree, insertNode, nullProc);// percore a arvore síntática fazendo a inserção de identificadores na tabela de simbolos
-// posssui três argumentos arvore sintática, função insertNode (insere na TS as informações sobre os nós de identificadores), nullProc nada é feito 
-  if (TraceAnalyze)
-  {
-    fprintf(listing, "\nSymbol table:\n\n");
-    printSymTab(listing);
-  }
-}
+  int lineno;
+  char *message;
+} PendingError;
+
+static int deferErrors = FALSE;
+static PendingError *pendingErrors = NULL;
+static int pendingCount = 0, pendingSize = 0;
 
 /* Emite uma mensagem de erro semantico indicando o número da linha e 
 seta a variável erro como true para signigficar que há um erro semantico
 */
-static void typeError(TreeNode *t, char *message)
+static void typeError(int lineno, char *message)
 {
-  fprintf(listing, "Type error at line %d: %s\n", t->lineno, message);
   Error = TRUE;
+  if (deferErrors)
+  {
+    if (pendingCount == pendingSize)
+    {
+      int size = (pendingSize == 0) ? 16 : pendingSize * 2;
+      PendingError *p = (PendingError *)realloc(pendingErrors, size * sizeof(PendingError));
+      if (p != NULL)
+      {
+        pendingErrors = p;
+        pendingSize = size;
+      }
+    }
+    if (pendingCount < pendingSize)
+    {
+      pendingErrors[pendingCount].lineno = lineno;
+      pendingErrors[pendingCount].message = message;
+      pendingCount++;
+      return;
+    }
+  }
+  fprintf(listing, "Type error at line %d: %s\n", lineno, message);
 }
 
-/* Faz a checagem de tipo a cada nó da arvore
+/* termina a análise combinada: lista a tabela de símbolos e emite
+os erros de tipo guardados, na ordem em que foram encontrados
  */
-static void checkNode(TreeNode *t)
+static void finishAnalysis(void)
 {
-  switch (t->nodekind)
+  int i;
+  deferErrors = FALSE;
+  if (TraceAnalyze)
+  {
+    fprintf(listing, "\nSymbol table:\n\n");
+    printSymTab(listing);
+    fprintf(listing, "\nChecking Types...\n");
+  }
+  for (i = 0; i < pendingCount; i++)
+    fprintf(listing, "Type error at line %d: %s\n",
+            pendingErrors[i].lineno, pendingErrors[i].message);
+  free(pendingErrors);
+  pendingErrors = NULL;
+  pendingCount = pendingSize = 0;
+}
+
+/* Aplica as regras de tipo a um nó, dados seu nodekind, kind, operador e
+linha, e o tipo e a linha de cada filho. Retorna o tipo do nó (Void para
+sentenças). Usada tanto pela árvore de ponteiros quanto pela árvore plana
+ */
+static ExpType checkRules(NodeKind nodekind, int kind, int op, int lineno,
+                          ExpType childType[], int childLine[])
+{
+  switch (nodekind)
   {
   case ExpK:
-    switch (t->kind.exp)
+    switch (kind)
     {
     case OpK:
       // se o nó é do tipo operador verifica se os filhos são do tipo integer
-      if ((t->child[0]->type != Integer) ||
-          (t->child[1]->type != Integer))
-        typeError(t, "Op applied to non-integer");
-      if ((t->attr.op == EQ) || (t->attr.op == LT)) //verifica se o operador é < ou =
-        t->type = Boolean; // se for a expressão á boleana
+      if ((childType[0] != Integer) ||
+          (childType[1] != Integer))
+        typeError(lineno, "Op applied to non-integer");
+      if ((op == EQ) || (op == LT)) //verifica se o operador é < ou =
+        return Boolean; // se for a expressão á boleana
       else
-        t->type = Integer; // se não inteira
-      break;
+        return Integer; // se não inteira
     case ConstK:
     case IdK:
-      t->type = Integer;
-      break;
+      return Integer;
     default:
       break;
     }
     break;
   case StmtK:
-    switch (t->kind.stmt)
+    switch (kind)
     {
     case IfK:
-      if (t->child[0]->type == Integer)
-        typeError(t->child[0], "if test is not Boolean");
+      if (childType[0] == Integer)
+        typeError(childLine[0], "if test is not Boolean");
       break;
     case AssignK:
-      if (t->child[0]->type != Integer)
-        typeError(t->child[0], "assignment of non-integer value");
+      if (childType[0] != Integer)
+        typeError(childLine[0], "assignment of non-integer value");
       break;
     case WriteK:
-      if (t->child[0]->type != Integer)
-        typeError(t->child[0], "write of non-integer value");
+      if (childType[0] != Integer)
+        typeError(childLine[0], "write of non-integer value");
       break;
     case RepeatK:
-      if (t->child[1]->type == Integer)
-        typeError(t->child[1], "repeat test is not Boolean");
+      if (childType[1] == Integer)
+        typeError(childLine[1], "repeat test is not Boolean");
       break;
     case WhileK:
-      if (t->child[1]->type == Integer)
-        typeError(t->child[1], "while test is not Boolean");
+      if (childType[1] == Integer)
+        typeError(childLine[1], "while test is not Boolean");
       break;
     default:
       break;
@@ -176,11 +190,84 @@ static void checkNode(TreeNode *t)
   default:
     break;
   }
+  return Void;
+}
+
+/* Faz a checagem de tipo a cada nó da arvore
+ */
+static void checkNode(TreeNode *t)
+{
+  ExpType childType[MAXCHILDREN];
+  int childLine[MAXCHILDREN];
+  ExpType type;
+  int i;
+  for (i = 0; i < MAXCHILDREN; i++)
+  {
+    childType[i] = (t->child[i] != NULL) ? t->child[i]->type : Void;
+    childLine[i] = (t->child[i] != NULL) ? t->child[i]->lineno : t->lineno;
+  }
+  if (t->nodekind == ExpK)
+  {
+    type = checkRules(ExpK, t->kind.exp, (t->kind.exp == OpK) ? t->attr.op : 0,
+                      t->lineno, childType, childLine);
+    t->type = type;
+  }
+  else
+    checkRules(StmtK, t->kind.stmt, 0, t->lineno, childType, childLine);
+}
+
+/* faz a análise semântica completa numa única travessia da árvore:
+insere os identificadores na tabela de símbolos em pré-ordem e verifica
+os tipos em pós-ordem
+ */
+void analyze(TreeNode *syntaxTree)
+{
+  deferErrors = TRUE;
+  traverseTree(syntaxTree, insertNode, checkNode);
+  finishAnalysis();
+}
+
+/**************************************************/
+/*********   Análise sobre a árvore plana   *******/
+/**************************************************/
+
+/* insere na tabela de símbolos o identificador do nó i da árvore plana */
+static void insertFlatNode(FlatTree *ft, unsigned int i)
+{
+  FlatNode *n = &ft->nodes[i];
+  NodeKind nodekind = FN_NODEKIND(n->header);
+  int kind = FN_KIND(n->header);
+  if (((nodekind == StmtK) && ((kind == AssignK) || (kind == ReadK))) ||
+      ((nodekind == ExpK) && (kind == IdK)))
+    ft->origin[i]->memloc = bindName(n->attr, n->lineno);
+}
+
+/* Faz a checagem de tipo do nó i da árvore plana */
+static void checkFlatNode(FlatTree *ft, unsigned int i)
+{
+  FlatNode *n = &ft->nodes[i];
+  ExpType childType[MAXCHILDREN];
+  int childLine[MAXCHILDREN];
+  ExpType type;
+  int k;
+  for (k = 0; k < MAXCHILDREN; k++)
+  {
+    unsigned int c = flatChild(ft, i, k);
+    childType[k] = (c != FLAT_NULL) ? FN_TYPE(ft->nodes[c].header) : Void;
+    childLine[k] = (c != FLAT_NULL) ? ft->nodes[c].lineno : n->lineno;
+  }
+  type = checkRules(FN_NODEKIND(n->header), FN_KIND(n->header), n->attr,
+                    n->lineno, childType, childLine);
+  if (FN_NODEKIND(n->header) == ExpK)
+    n->header = FN_SETTYPE(n->header, type);
 }
 
-/* faz a verificação de tipos em relação a arvore sintatica que recebe como argumento
+/* faz a análise semântica completa da árvore plana num único
+flatTraverse: identificadores em pré-ordem, tipos em pós-ordem
  */
-void typeCheck(TreeNode *syntaxTree)
+void analyzeFlat(FlatTree *ft)
 {
-  traverse(syntaxTree, nullProc, checkNode);  // traverse aplica a função checkNode sobre cada nó enquanto percorre a árvore
+  deferErrors = TRUE;
+  flatTraverse(ft, insertFlatNode, checkFlatNode);
+  finishAnalysis();
 }
@@ -8,14 +8,14 @@
 #ifndef _ANALYZE_H_
 #define _ANALYZE_H_
 
-/* Function buildSymtab constructs the symbol 
- * table by preorder traversal of the syntax tree
+/* Procedures analyze and analyzeFlat (over the
+ * flat form of the syntax tree, see flat.h) do
+ * the semantic analysis in a single traversal:
+ * symbols are bound in preorder and types checked
+ * in postorder; the symbol table is listed before
+ * the type errors
  */
-void buildSymtab(TreeNode *);
-
-/* Procedure typeCheck performs type checking 
- * by a postorder syntax tree traversal
- */
-void typeCheck(TreeNode *);
+void analyze(TreeNode *);
+void analyzeFlat(FlatTree *);
 
 #endif
@@ -0,0 +1,81 @@
+/****************************************************/
+/* File: arena.c                                    */
+/* Arena (bump) allocator implementation            */
+/* Memory is carved from large chunks by bumping a  */
+/* pointer; chunks are only freed all together      */
+/****************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/* CHUNKSIZE is the default size of each chunk */
+#define CHUNKSIZE (256 * 1024)
+
+/* every allocation is rounded up to ALIGN bytes */
+#define ALIGN 8
+
+typedef struct ChunkRec
+{
+  struct ChunkRec *next;
+  size_t size; /* usable bytes after the header */
+  size_t used;
+} Chunk;
+
+/* size of the chunk header, rounded up to ALIGN */
+#define HEADER ((sizeof(Chunk) + ALIGN - 1) & ~(size_t)(ALIGN - 1))
+
+static Chunk *chunks = NULL; /* current chunk first */
+static long allocCount = 0;
+static long allocBytes = 0;
+
+/* Function arenaAlloc returns size bytes of
+ * zero-filled memory owned by the arena
+ */
+void *arenaAlloc(size_t size)
+{
+  char *p;
+  size = (size + ALIGN - 1) & ~(size_t)(ALIGN - 1);
+  if ((chunks == NULL) || (chunks->used + size > chunks->size))
+  {
+    size_t n = (size > CHUNKSIZE) ? size : CHUNKSIZE;
+    Chunk *c = (Chunk *)malloc(HEADER + n);
+    if (c == NULL)
+      return NULL;
+    c->size = n;
+    c->used = 0;
+    c->next = chunks;
+    chunks = c;
+  }
+  p = (char *)chunks + HEADER + chunks->used;
+  chunks->used += size;
+  allocCount++;
+  allocBytes += (long)size;
+  memset(p, 0, size);
+  return p;
+} /* arenaAlloc */
+
+/* Procedure arenaFree releases every block
+ * allocated by arenaAlloc
+ */
+void arenaFree(void)
+{
+  while (chunks != NULL)
+  {
+    Chunk *next = chunks->next;
+    free(chunks);
+    chunks = next;
+  }
+  allocCount = 0;
+  allocBytes = 0;
+}
+
+long arenaCount(void)
+{
+  return allocCount;
+}
+
+long arenaBytes(void)
+{
+  return allocBytes;
+}
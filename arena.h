@@ -0,0 +1,31 @@
+/****************************************************/
+/* File: arena.h                                    */
+/* Arena (bump) allocator for the TINY compiler:    */
+/* owns the syntax tree, names and cross-reference  */
+/* records of one compilation, released at once    */
+/****************************************************/
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+/* Function arenaAlloc returns size bytes of
+ * zero-filled memory owned by the arena, or
+ * NULL if memory is exhausted
+ */
+void *arenaAlloc(size_t size);
+
+/* Procedure arenaFree releases every block
+ * allocated by arenaAlloc since the last call
+ */
+void arenaFree(void);
+
+/* Functions arenaCount and arenaBytes return the
+ * number of allocations and bytes handed out
+ * since the last arenaFree
+ */
+long arenaCount(void);
+long arenaBytes(void);
+
+#endif
@@ -0,0 +1,41 @@
+/****************************************************/
+/* File: bench/scandrv.c                            */
+/* Scanner microbenchmark: times getToken over a    */
+/* whole source file, with every trace off; built   */
+/* against the sources of a TINY tree by            */
+/* benchscan.sh                                     */
+/****************************************************/
+
+/* main.c supplies the globals of the compiler; its
+ * main is renamed out of the way
+ */
+#define main tinyMain
+#include "main.c"
+#undef main
+
+#include <time.h>
+
+int main(int argc, char *argv[])
+{
+  long count = 0;
+  clock_t start;
+  if (argc != 2)
+  {
+    fprintf(stderr, "usage: %s <filename>\n", argv[0]);
+    return 1;
+  }
+  source = fopen(argv[1], "r");
+  if (source == NULL)
+  {
+    fprintf(stderr, "File %s not found\n", argv[1]);
+    return 1;
+  }
+  listing = stdout;
+  EchoSource = TraceScan = FALSE;
+  start = clock();
+  while (getToken() != ENDFILE)
+    count++;
+  printf("%ld tokens, %.3f s\n", count,
+         (double)(clock() - start) / CLOCKS_PER_SEC);
+  return 0;
+}
@@ -0,0 +1,60 @@
+/****************************************************/
+/* File: bench/symdrv.c                             */
+/* Symbol table benchmark: times st_insert of the   */
+/* names v0, v1, ... and one st_lookup pass over    */
+/* them, for each size given; built against the     */
+/* sources of a TINY tree by benchsymtab.sh         */
+/****************************************************/
+
+/* main.c supplies the globals of the compiler; its
+ * main is renamed out of the way
+ */
+#define main tinyMain
+#include "main.c"
+#undef main
+
+#include <time.h>
+
+static double seconds(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+  char name[32];
+  int i, n, arg, missing;
+  clock_t start;
+  double insert;
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s <names> ...\n", argv[0]);
+    return 1;
+  }
+  listing = stdout;
+  for (arg = 1; arg < argc; arg++)
+  {
+    n = atoi(argv[arg]);
+    start = clock();
+    for (i = 0; i < n; i++)
+    {
+      sprintf(name, "v%d", i);
+      st_insert(name, 1, i);
+    }
+    insert = seconds(start);
+    missing = 0;
+    start = clock();
+    for (i = 0; i < n; i++)
+    {
+      sprintf(name, "v%d", i);
+      if (st_lookup(name) != i)
+        missing++;
+    }
+    printf("%8d names: insert %8.4f s, lookup %8.4f s%s\n", n, insert,
+           seconds(start), (missing > 0) ? ", WRONG LOCATIONS" : "");
+    freeSymTab();
+    freeNames();
+    arenaFree();
+  }
+  return 0;
+}
@@ -0,0 +1,68 @@
+/****************************************************/
+/* File: bench/tmdrv.c                              */
+/* TM engine benchmark: runs a program with stepTM  */
+/* called once per instruction, with the threaded   */
+/* runTM and with the JIT, and reports the          */
+/* instructions per second of each (see benchtm.sh) */
+/****************************************************/
+
+/* tm.c supplies the simulator; its main is renamed
+ * out of the way
+ */
+#define main tmMain
+#include "tm.c"
+#undef main
+
+#include <time.h>
+
+int main(int argc, char *argv[])
+{
+  static char *engine[] = {"stepTM", "runTM", "runJIT"};
+  long count, steps = 0;
+  STEPRESULT result;
+  clock_t start;
+  double secs;
+  int e;
+  if (argc != 2)
+  {
+    fprintf(stderr, "usage: %s <filename>\n"
+                    "(one input line per engine for each IN)\n", argv[0]);
+    return 1;
+  }
+  pgmName = argv[1];
+  pgm = fopen(pgmName, "r");
+  if (pgm == NULL)
+  {
+    fprintf(stderr, "file '%s' not found\n", pgmName);
+    return 1;
+  }
+  if (!readInstructions())
+    return 1;
+  batch = TRUE;
+  for (e = 0; e < 3; e++)
+  {
+    clearMachine();
+    count = 0;
+    start = clock();
+    if (e == 0)
+    {
+      do
+        count++;
+      while ((result = stepTM()) == srOKAY);
+      steps = count;
+    }
+    else if (e == 1)
+      result = runTM(&count);
+    else
+    { /* the JIT does not count: same program, same steps */
+      result = runJIT();
+      count = steps;
+    }
+    secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    fflush(stdout);
+    printf("%-7s %s, %ld instructions, %.3f s, %.1f M instructions/s\n",
+           engine[e], stepResultTab[result], count, secs,
+           (secs > 0) ? count / secs / 1e6 : 0.0);
+  }
+  return 0;
+}
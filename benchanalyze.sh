@@ -0,0 +1,72 @@
+#!/bin/sh
+# File: benchanalyze.sh
+# Semantic analysis benchmark: tiny, built from
+# this tree and from an earlier one, compiles a
+# generated program of about 1.5M syntax tree
+# nodes with -time-report; the CPU time of the
+# analysis phases (symtab and typecheck in the
+# earlier tree, analyze in this one) is reported
+# for the pointer tree and with -flat
+#
+# usage: ./benchanalyze.sh [rev]
+# rev is the git revision of the earlier tree
+# (default: the one before the fused analysis
+# pass, with separate binding and checking walks)
+#
+# CC and CFLAGS choose the C compiler; LINES sets
+# the size of the program; RUNS sets the runs of
+# each compiler
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-O2"}
+LINES=${LINES:-100000}
+RUNS=${RUNS:-3}
+top=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d "${TMPDIR:-/tmp}/benchanalyze.XXXXXX") || exit 1
+trap 'rm -rf "$work"' 0
+trap 'exit 1' 1 2 15
+
+rev=${1:-$(git -C "$top" log --format=%H --grep='^\[user-014\] ' | tail -n 1)^}
+mkdir "$work/old"
+git -C "$top" archive "$rev" | tar -x -C "$work/old" || exit 1
+
+# build name tree [flags]: the compiler in tree
+build()
+{
+  $CC $CFLAGS $3 -o "$work/$1.tiny" \
+    $(ls "$2"/*.c | grep -v '/tm\.c$') || exit 1
+}
+
+build old "$work/old" -w # its warnings are of no interest here
+build new "$top"
+
+# assignments, tests and loops over 1000 variables
+awk -v n="$LINES" 'BEGIN {
+  for (i = 0; i < 1000; i++)
+    printf "read v%d;\n", i
+  for (i = 0; i < n; i++) {
+    a = i % 1000; b = (i * 7) % 1000; c = (i * 13) % 1000
+    printf "v%d := v%d + v%d * 3 - v%d / 7 + v%d - %d;\n", a, b, c, a, (b + 1) % 1000, i % 50
+    if (i % 10 == 0)
+      printf "if v%d < v%d then v%d := v%d - 1; else write v%d; endif;\n", b, c, a, a, b
+    if (i % 25 == 0)
+      printf "while v%d < %d v%d := v%d + v%d; endwhile;\n", c, i % 10, c, c, a
+  }
+}' > "$work/input.tny"
+
+for tree in old new; do
+  for flat in "" -flat; do
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+      "$work/$tree.tiny" -quiet $flat -time-report -o "$work/input.tm" \
+        "$work/input.tny" 2>&1 > /dev/null |
+        awk -v t="$tree$flat" '
+          $1 == "symtab" || $1 == "typecheck" || $1 == "analyze" {
+            ms += $3; p = p (p == "" ? "" : " + ") $1
+          }
+          $1 == "parse" { nodes = $(NF - 1) }
+          END { printf "%-9s %s: %.1f ms cpu (%d nodes)\n", t ":", p, ms, nodes }'
+      i=$((i + 1))
+    done
+  done
+done
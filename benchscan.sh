@@ -0,0 +1,57 @@
+#!/bin/sh
+# File: benchscan.sh
+# Scanner microbenchmark: bench/scandrv.c, built
+# against this tree and against an earlier one,
+# runs getToken over a generated source file of
+# several MB and reports the time of each run
+#
+# usage: ./benchscan.sh [rev]
+# rev is the git revision of the earlier tree
+# (default: the one before the table-driven
+# scanner, whose getToken is a nested switch)
+#
+# CC and CFLAGS choose the C compiler; LINES sets
+# the size of the input (200000 lines, about
+# 20 MB); RUNS sets the runs of each scanner
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-O2"}
+LINES=${LINES:-200000}
+RUNS=${RUNS:-3}
+top=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d "${TMPDIR:-/tmp}/benchscan.XXXXXX") || exit 1
+trap 'rm -rf "$work"' 0
+trap 'exit 1' 1 2 15
+
+rev=${1:-$(git -C "$top" log --format=%H --grep='^\[user-002\] ' | tail -n 1)^}
+mkdir "$work/old"
+git -C "$top" archive "$rev" | tar -x -C "$work/old" || exit 1
+
+# build name tree [flags]: the driver against the compiler in tree
+build()
+{
+  $CC $CFLAGS $3 -I"$2" -o "$work/$1.scan" "$top/bench/scandrv.c" \
+    $(ls "$2"/*.c | grep -v '/main\.c$' | grep -v '/tm\.c$') || exit 1
+}
+
+build old "$work/old" -w # its warnings are of no interest here
+build new "$top"
+
+# identifiers, numbers, operators, keywords and comments
+awk -v n="$LINES" 'BEGIN {
+  for (i = 0; i < n; i++) {
+    printf "{ line %d of the scanner benchmark input }\n", i
+    printf "if counter%d < %d then total := total + value_%d * 17; ", i % 1000, i, i % 97
+    printf "else repeat x := x - 1 until x = 0; endif;\n"
+  }
+}' > "$work/input.tny"
+
+echo "input: $(wc -c < "$work/input.tny") bytes, $((LINES * 2)) lines"
+for scanner in old new; do
+  i=0
+  while [ $i -lt "$RUNS" ]; do
+    printf '%s: ' $scanner
+    "$work/$scanner.scan" "$work/input.tny"
+    i=$((i + 1))
+  done
+done
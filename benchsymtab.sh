@@ -0,0 +1,42 @@
+#!/bin/sh
+# File: benchsymtab.sh
+# Symbol table benchmark: bench/symdrv.c, built
+# against this tree and against an earlier one,
+# inserts and looks up 1k, 100k and 1M names and
+# reports the time of each
+#
+# usage: ./benchsymtab.sh [rev]
+# rev is the git revision of the earlier tree
+# (default: the one before the open-addressing
+# table, with 211 chained buckets; at 1M names it
+# takes minutes)
+#
+# CC and CFLAGS choose the C compiler; SIZES sets
+# the numbers of names
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-O2"}
+SIZES=${SIZES:-"1000 100000 1000000"}
+top=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d "${TMPDIR:-/tmp}/benchsymtab.XXXXXX") || exit 1
+trap 'rm -rf "$work"' 0
+trap 'exit 1' 1 2 15
+
+rev=${1:-$(git -C "$top" log --format=%H --grep='^\[user-011\] ' | tail -n 1)^}
+mkdir "$work/old"
+git -C "$top" archive "$rev" | tar -x -C "$work/old" || exit 1
+
+# build name tree [flags]: the driver against the compiler in tree
+build()
+{
+  $CC $CFLAGS $3 -I"$2" -o "$work/$1.sym" "$top/bench/symdrv.c" \
+    $(ls "$2"/*.c | grep -v '/main\.c$' | grep -v '/tm\.c$') || exit 1
+}
+
+build old "$work/old" -w # its warnings are of no interest here
+build new "$top"
+
+for table in new old; do
+  echo "$table:"
+  "$work/$table.sym" $SIZES
+done
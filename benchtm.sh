@@ -0,0 +1,31 @@
+#!/bin/sh
+# File: benchtm.sh
+# TM engine benchmark: corpus/loop.tny, compiled
+# at -O0 and -O2, runs with stepTM called once per
+# instruction, with the threaded runTM and with the
+# JIT (bench/tmdrv.c); the instructions per second
+# of each engine are reported
+#
+# usage: ./benchtm.sh [n]
+# n is the loop count read by the program
+# (default 30000000, about 630M instructions at -O0)
+#
+# CC and CFLAGS choose the C compiler
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-O2"}
+n=${1:-30000000}
+top=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d "${TMPDIR:-/tmp}/benchtm.XXXXXX") || exit 1
+trap 'rm -rf "$work"' 0
+trap 'exit 1' 1 2 15
+
+$CC $CFLAGS -o "$work/tiny" $(ls "$top"/*.c | grep -v '/tm\.c$') || exit 1
+$CC $CFLAGS -I"$top" -o "$work/tmdrv" "$top/bench/tmdrv.c" || exit 1
+
+for opt in -O0 -O2; do
+  "$work/tiny" -quiet $opt -o "$work/loop.tm" "$top/corpus/loop.tny" > /dev/null || exit 1
+  echo "loop.tny $opt, n = $n:"
+  printf '%s\n%s\n%s\n' "$n" "$n" "$n" | "$work/tmdrv" "$work/loop.tm" |
+    grep -v '^-*[0-9]*$' # the sum written by each run
+done
@@ -8,7 +8,8 @@
 /****************************************************/
 
 #include "globals.h"
-#include "symtab.h"
+#include "util.h"
+#include "intern.h"
 #include "code.h"
 #include "cgen.h"
 
@@ -21,6 +22,649 @@ static int tmpOffset = 0;
 /* prototype for internal recursive code generator */
 static void cGen(TreeNode *tree);
 
+/* With -O2 the variables used most inside a loop nest
+ * live in registers maxreg, maxreg-1, ... while the
+ * loop runs; expression temporaries then use only the
+ * registers from ac up to tempMax
+ */
+#define MAXPROMOTED 2
+
+static int promotedLoc[MAXPROMOTED];
+static int promotedWritten[MAXPROMOTED];
+static int numPromoted = 0;
+static int tempMax = maxreg;
+
+/* Function promotedReg returns the register that holds
+ * the variable at memory location loc, or -1
+ */
+static int promotedReg(int loc)
+{
+   int i;
+   for (i = 0; i < numPromoted; i++)
+      if (promotedLoc[i] == loc)
+         return maxreg - i;
+   return -1;
+}
+
+/* weighted uses of each memory location in the loop
+ * nest being examined, and the locations touched
+ */
+typedef struct
+{
+   int uses;
+   int atom;
+   int written;
+} LocUse;
+
+static LocUse *locUse = NULL;
+static int locUseSize = 0;
+static int *usedLocs = NULL;
+static int numUsed = 0, usedLocsSize = 0;
+static int loopDepth;
+
+/* Procedure countUse adds the use of a variable by
+ * node tree to locUse; a use in a loop nested k
+ * deep inside the nest weighs 8^k
+ */
+static void countUse(TreeNode *tree)
+{
+   LocUse *u;
+   int loc;
+   if ((tree->nodekind == StmtK) &&
+       ((tree->kind.stmt == WhileK) || (tree->kind.stmt == RepeatK)))
+      loopDepth++;
+   if (!(((tree->nodekind == ExpK) && (tree->kind.exp == IdK)) ||
+         ((tree->nodekind == StmtK) &&
+          ((tree->kind.stmt == AssignK) || (tree->kind.stmt == ReadK)))))
+      return;
+   loc = tree->memloc;
+   if (loc >= locUseSize)
+   {
+      int size = (locUseSize == 0) ? 64 : locUseSize;
+      LocUse *p;
+      while (loc >= size)
+         size *= 2;
+      p = (LocUse *)realloc(locUse, size * sizeof(LocUse));
+      if (p == NULL)
+         return;
+      memset(p + locUseSize, 0, (size - locUseSize) * sizeof(LocUse));
+      locUse = p;
+      locUseSize = size;
+   }
+   u = &locUse[loc];
+   if (u->uses == 0)
+   {
+      if (numUsed == usedLocsSize)
+      {
+         int size = (usedLocsSize == 0) ? 64 : usedLocsSize * 2;
+         int *p = (int *)realloc(usedLocs, size * sizeof(int));
+         if (p == NULL)
+            return;
+         usedLocs = p;
+         usedLocsSize = size;
+      }
+      usedLocs[numUsed++] = loc;
+      u->atom = tree->attr.atom;
+   }
+   u->uses += 1 << (3 * ((loopDepth < 6) ? loopDepth : 6));
+   if (tree->nodekind == StmtK)
+      u->written = TRUE;
+}
+
+static void countEnd(TreeNode *tree)
+{
+   if ((tree->nodekind == StmtK) &&
+       ((tree->kind.stmt == WhileK) || (tree->kind.stmt == RepeatK)))
+      loopDepth--;
+}
+
+/* Procedure promoteVars picks the variables used most
+ * (at least twice) in the loop tree and loads them
+ * into their registers before the loop
+ */
+static void promoteVars(TreeNode *tree)
+{
+   int i, k;
+   loopDepth = 0;
+   numUsed = 0;
+   for (i = 0; i < MAXCHILDREN; i++)
+      traverseTree(tree->child[i], countUse, countEnd);
+   for (numPromoted = 0; numPromoted < MAXPROMOTED; numPromoted++)
+   {
+      int best = -1;
+      for (i = 0; i < numUsed; i++)
+      {
+         LocUse *u = &locUse[usedLocs[i]];
+         if ((u->uses >= 2) && (promotedReg(usedLocs[i]) < 0) &&
+             ((best < 0) || (u->uses > locUse[best].uses)))
+            best = usedLocs[i];
+      }
+      if (best < 0)
+         break;
+      promotedLoc[numPromoted] = best;
+      promotedWritten[numPromoted] = locUse[best].written;
+   }
+   if ((numPromoted > 0) && TraceCode)
+      fprintf(listing, "Loop at line %d: promoted to registers:", tree->lineno);
+   for (k = 0; k < numPromoted; k++)
+   {
+      if (TraceCode)
+         fprintf(listing, " %s (r%d)", atomName(locUse[promotedLoc[k]].atom), maxreg - k);
+      emitRM("LD", maxreg - k, promotedLoc[k], gp, "promote: load variable");
+   }
+   if ((numPromoted > 0) && TraceCode)
+      fprintf(listing, "\n");
+   tempMax = maxreg - numPromoted;
+   for (i = 0; i < numUsed; i++)
+      memset(&locUse[usedLocs[i]], 0, sizeof(LocUse));
+}
+
+/* Procedure releaseVars stores the promoted variables
+ * written in the loop back to memory after it
+ */
+static void releaseVars(void)
+{
+   int k;
+   for (k = 0; k < numPromoted; k++)
+      if (promotedWritten[k])
+         emitRM("ST", maxreg - k, promotedLoc[k], gp, "promote: store variable");
+   numPromoted = 0;
+   tempMax = maxreg;
+}
+
+/* Procedure labelNode computes, in postorder, the
+ * Sethi-Ullman number of an expression node: the
+ * number of registers needed to evaluate it without
+ * temporaries in memory, kept in its regs field
+ */
+static int need(TreeNode *tree);
+
+static void labelNode(TreeNode *tree)
+{
+   int l, r;
+   if ((tree->nodekind != ExpK) || (tree->kind.exp != OpK))
+      return;
+   l = need(tree->child[0]);
+   r = need(tree->child[1]);
+   tree->regs = (l == r) ? l + 1 : (l > r) ? l : r;
+}
+
+static void noLabel(TreeNode *tree)
+{
+}
+
+/* Function need returns the registers needed by the
+ * expression tree (none for a promoted variable)
+ */
+static int need(TreeNode *tree)
+{
+   if (tree->kind.exp == OpK)
+      return tree->regs;
+   if ((tree->kind.exp == IdK) && (promotedReg(tree->memloc) >= 0))
+      return 0;
+   return 1;
+}
+
+/* Function operandReg returns the register that holds
+ * the operand tree without generating code for it
+ * (a promoted variable), or -1
+ */
+static int operandReg(TreeNode *tree)
+{
+   return (tree->kind.exp == IdK) ? promotedReg(tree->memloc) : -1;
+}
+
+/* Function arithOp returns the TM instruction of an
+ * arithmetic operator, or NULL for a comparison
+ */
+static char *arithOp(TokenType op)
+{
+   switch (op)
+   {
+   case PLUS:
+      return "ADD";
+   case MINUS:
+      return "SUB";
+   case TIMES:
+      return "MUL";
+   case OVER:
+      return "DIV";
+   default:
+      return NULL;
+   }
+}
+
+/* Function opComment returns the code comment of the
+ * instruction for operator op
+ */
+static char *opComment(TokenType op)
+{
+   switch (op)
+   {
+   case PLUS:
+      return "op +";
+   case MINUS:
+      return "op -";
+   case TIMES:
+      return "op *";
+   case OVER:
+      return "op /";
+   case LT:
+      return "op <";
+   default:
+      return "op ==";
+   }
+}
+
+/* Expression code is generated from an explicit,
+ * heap-allocated stack of pending steps rather than
+ * by recursion, so that C stack usage stays constant
+ * however deep the expression is. Steps are pushed in
+ * reverse order of execution
+ */
+typedef enum
+{
+   gExp,    /* value of node into ac, without -O */
+   gExpReg, /* value of node into register r (-O) */
+   gBinary, /* operands of node, then as gOp */
+   gPush,   /* register r into a new temporary */
+   gOp      /* "op dest,lreg,rreg" (loading lreg from the
+               last temporary first if load), then the 0/1
+               value of a comparison by jump, and the
+               closing comment of the operator if endOp */
+} GenStep;
+
+typedef struct
+{
+   GenStep step;
+   TreeNode *node;
+   int r, dest, lreg, rreg;
+   int load, endOp;
+   char *op, *comment, *jump;
+} GenTask;
+
+static GenTask *genStack = NULL;
+static int genSp = 0, genSize = 0;
+
+/* Function pushTask pushes a step and returns it for
+ * the caller to fill in
+ */
+static GenTask *pushTask(GenStep step, TreeNode *node, int r)
+{
+   GenTask *t;
+   if (genSp == genSize)
+   {
+      int size = (genSize == 0) ? 64 : genSize * 2;
+      GenTask *p = (GenTask *)realloc(genStack, size * sizeof(GenTask));
+      if (p == NULL)
+      {
+         fprintf(listing, "Out of memory error generating code\n");
+         exit(1);
+      }
+      genStack = p;
+      genSize = size;
+   }
+   t = &genStack[genSp++];
+   memset(t, 0, sizeof(GenTask));
+   t->step = step;
+   t->node = node;
+   t->r = r;
+   return t;
+}
+
+static GenTask *pushOp(char *op, int dest, int lreg, int rreg, char *comment)
+{
+   GenTask *t = pushTask(gOp, NULL, dest);
+   t->op = op;
+   t->dest = dest;
+   t->lreg = lreg;
+   t->rreg = rreg;
+   t->comment = comment;
+   return t;
+}
+
+/* Procedure expandExp pushes the steps for the
+ * expression tree without -O: the left operand goes
+ * through a temporary in memory while the right one
+ * is computed in ac
+ */
+static void expandExp(TreeNode *tree)
+{
+   GenTask *t;
+   switch (tree->kind.exp)
+   {
+   case ConstK:
+      if (TraceCode)
+         emitComment("-> Const");
+      /* gen code to load integer constant using LDC */
+      emitRM("LDC", ac, tree->attr.val, 0, "load const");
+      if (TraceCode)
+         emitComment("<- Const");
+      break; /* ConstK */
+
+   case IdK:
+      if (TraceCode)
+         emitComment("-> Id");
+      emitRM("LD", ac, tree->memloc, gp, "load id value");
+      if (TraceCode)
+         emitComment("<- Id");
+      break; /* IdK */
+
+   case OpK:
+      if (TraceCode)
+         emitComment("-> Op");
+      if ((arithOp(tree->attr.op) == NULL) &&
+          (tree->attr.op != LT) && (tree->attr.op != EQ))
+      {
+         emitComment("BUG: Unknown operator");
+         break;
+      }
+      t = pushOp((arithOp(tree->attr.op) != NULL) ? arithOp(tree->attr.op) : "SUB",
+                 ac, ac1, ac, opComment(tree->attr.op));
+      t->load = TRUE;
+      t->jump = (tree->attr.op == LT) ? "JLT" : (tree->attr.op == EQ) ? "JEQ" : NULL;
+      t->endOp = TRUE;
+      pushTask(gExp, tree->child[1], ac);
+      pushTask(gPush, NULL, ac);
+      pushTask(gExp, tree->child[0], ac);
+      break; /* OpK */
+
+   default:
+      break;
+   }
+}
+
+/* Procedure expandExpReg pushes the steps that leave
+ * the value of the expression tree in register r,
+ * using registers r to tempMax (labelNode must have
+ * run)
+ */
+static void expandExpReg(TreeNode *tree, int r)
+{
+   GenTask *t;
+   switch (tree->kind.exp)
+   {
+   case ConstK:
+      emitRM("LDC", r, tree->attr.val, 0, "load const");
+      break;
+   case IdK:
+      if (promotedReg(tree->memloc) >= 0)
+         emitRM("LDA", r, 0, promotedReg(tree->memloc), "copy promoted id");
+      else
+         emitRM("LD", r, tree->memloc, gp, "load id value");
+      break;
+   case OpK:
+      if (TraceCode)
+         emitComment("-> Op");
+      if ((arithOp(tree->attr.op) == NULL) &&
+          (tree->attr.op != LT) && (tree->attr.op != EQ))
+      {
+         emitComment("BUG: Unknown operator");
+         if (TraceCode)
+            emitComment("<- Op");
+         break;
+      }
+      t = pushTask(gBinary, tree, r);
+      t->op = (arithOp(tree->attr.op) != NULL) ? arithOp(tree->attr.op) : "SUB";
+      t->dest = r;
+      t->comment = opComment(tree->attr.op);
+      t->jump = (tree->attr.op == LT) ? "JLT" : (tree->attr.op == EQ) ? "JEQ" : NULL;
+      t->endOp = TRUE;
+      break;
+   default:
+      break;
+   }
+}
+
+/* Procedure expandBinary pushes the steps for the
+ * operands of the operation in task b and then
+ * "op dest,left,right", using registers r to
+ * tempMax. The operand that needs more registers is
+ * evaluated first; when both need more than there
+ * are, the first is kept in a temporary in memory.
+ * Promoted variables are used from their registers
+ */
+static void expandBinary(GenTask *b)
+{
+   TreeNode *left = b->node->child[0];
+   TreeNode *right = b->node->child[1];
+   int r = b->r;
+   int lreg = operandReg(left), rreg = operandReg(right);
+   int avail = tempMax - r + 1;
+   GenTask *t = pushOp(b->op, b->dest, lreg, rreg, b->comment);
+   t->jump = b->jump;
+   t->endOp = b->endOp;
+   if ((lreg >= 0) && (rreg < 0))
+   {
+      t->rreg = r;
+      pushTask(gExpReg, right, r);
+   }
+   else if ((lreg < 0) && (rreg >= 0))
+   {
+      t->lreg = r;
+      pushTask(gExpReg, left, r);
+   }
+   else if ((lreg < 0) && (rreg < 0))
+   {
+      if ((need(left) >= avail) && (need(right) >= avail))
+      {
+         t->lreg = r + 1;
+         t->rreg = r;
+         t->load = TRUE;
+         pushTask(gExpReg, right, r);
+         pushTask(gPush, NULL, r);
+         pushTask(gExpReg, left, r);
+      }
+      else if (need(right) > need(left))
+      {
+         t->lreg = r + 1;
+         t->rreg = r;
+         pushTask(gExpReg, left, r + 1);
+         pushTask(gExpReg, right, r);
+      }
+      else
+      {
+         t->lreg = r;
+         t->rreg = r + 1;
+         pushTask(gExpReg, right, r + 1);
+         pushTask(gExpReg, left, r);
+      }
+   }
+}
+
+/* Procedure runTasks carries out the pending steps
+ * until the stack is empty
+ */
+static void runTasks(void)
+{
+   while (genSp > 0)
+   {
+      GenTask t = genStack[--genSp];
+      switch (t.step)
+      {
+      case gExp:
+         expandExp(t.node);
+         break;
+      case gExpReg:
+         expandExpReg(t.node, t.r);
+         break;
+      case gBinary:
+         expandBinary(&t);
+         break;
+      case gPush:
+         emitRM("ST", t.r, tmpOffset--, mp, "op: push left");
+         break;
+      case gOp:
+         if (t.load)
+            emitRM("LD", t.lreg, ++tmpOffset, mp, "op: load left");
+         emitRO(t.op, t.dest, t.lreg, t.rreg, t.comment);
+         if (t.jump != NULL)
+         {
+            emitRM(t.jump, t.dest, 2, pc, "br if true");
+            emitRM("LDC", t.dest, 0, t.dest, "false case");
+            emitRM("LDA", pc, 1, pc, "unconditional jmp");
+            emitRM("LDC", t.dest, 1, t.dest, "true case");
+         }
+         if (t.endOp && TraceCode)
+            emitComment("<- Op");
+         break;
+      }
+   }
+}
+
+/* Procedure genBinary generates code for the operands
+ * of the operation tree and then "op dest,left,right",
+ * using registers r to tempMax (see expandBinary)
+ */
+static void genBinary(TreeNode *tree, int r, int dest, char *op, char *comment)
+{
+   GenTask *t = pushTask(gBinary, tree, r);
+   t->dest = dest;
+   t->op = op;
+   t->comment = comment;
+   runTasks();
+}
+
+/* Procedure genExpReg generates code that leaves the
+ * value of the expression tree in register r
+ */
+static void genExpReg(TreeNode *tree, int r)
+{
+   pushTask(gExpReg, tree, r);
+   runTasks();
+}
+
+/* Function genCond generates code for the test of an
+ * if, while or repeat (with -O) and returns the
+ * conditional jump, on ac, taken when the test is
+ * false: a comparison becomes a SUB followed directly
+ * by the inverted jump, without building its 0/1
+ * value. It returns NULL (and generates nothing) for
+ * a test that is always true
+ */
+static char *genCond(TreeNode *tree)
+{
+   if ((tree->kind.exp == ConstK) && (tree->attr.val != 0))
+      return NULL;
+   if ((tree->kind.exp == OpK) && ((tree->attr.op == LT) || (tree->attr.op == EQ)))
+   {
+      if (TraceCode)
+         emitComment("-> Cond");
+      traverseTree(tree, noLabel, labelNode);
+      genBinary(tree, ac, ac, "SUB", (tree->attr.op == LT) ? "cond <" : "cond ==");
+      if (TraceCode)
+         emitComment("<- Cond");
+      return (tree->attr.op == LT) ? "JGE" : "JNE";
+   }
+   cGen(tree);
+   return "JEQ";
+}
+
+/* Function invertJump returns the conditional jump
+ * taken exactly when jump is not
+ */
+static char *invertJump(char *jump)
+{
+   if (strcmp(jump, "JGE") == 0)
+      return "JLT";
+   if (strcmp(jump, "JNE") == 0)
+      return "JEQ";
+   return "JNE";
+}
+
+/* Procedure genIf generates code for an if statement
+ * whose test jumps to the else part when false
+ */
+static void genIf(TreeNode *tree)
+{
+   int savedLoc1 = 0, savedLoc2 = 0, currentLoc;
+   char *jumpFalse;
+   if (TraceCode)
+      emitComment("-> if");
+   jumpFalse = genCond(tree->child[0]);
+   if (jumpFalse != NULL)
+   {
+      savedLoc1 = emitSkip(1);
+      emitComment("if: jump to else belongs here");
+   }
+   cGen(tree->child[1]);
+   if (tree->child[2] != NULL)
+   {
+      savedLoc2 = emitSkip(1);
+      emitComment("if: jump to end belongs here");
+   }
+   if (jumpFalse != NULL)
+   {
+      currentLoc = emitSkip(0);
+      emitBackup(savedLoc1);
+      emitRM_Abs(jumpFalse, ac, currentLoc, "if: jmp to else");
+      emitRestore();
+   }
+   if (tree->child[2] != NULL)
+   {
+      cGen(tree->child[2]);
+      currentLoc = emitSkip(0);
+      emitBackup(savedLoc2);
+      emitRM_Abs("LDA", pc, currentLoc, "jmp to end");
+      emitRestore();
+   }
+   if (TraceCode)
+      emitComment("<- if");
+}
+
+/* Procedure genRepeat generates code for a repeat
+ * statement whose test jumps back to the body
+ */
+static void genRepeat(TreeNode *tree)
+{
+   int savedLoc1;
+   char *jumpFalse;
+   if (TraceCode)
+      emitComment("-> repeat");
+   savedLoc1 = emitSkip(0);
+   emitComment("repeat: jump after body comes back here");
+   cGen(tree->child[0]);
+   jumpFalse = genCond(tree->child[1]);
+   if (jumpFalse != NULL)
+      emitRM_Abs(jumpFalse, ac, savedLoc1, "repeat: jmp back to body");
+   if (TraceCode)
+      emitComment("<- repeat");
+}
+
+/* Procedure genWhile generates code for a rotated
+ * while loop: the test is made once before entering
+ * the loop and then again after the body, where a
+ * single conditional jump goes back to the body
+ */
+static void genWhile(TreeNode *tree)
+{
+   int savedLoc1 = 0, bodyLoc, currentLoc;
+   char *jumpFalse;
+   if (TraceCode)
+      emitComment("-> while");
+   jumpFalse = genCond(tree->child[0]);
+   if (jumpFalse != NULL)
+   {
+      savedLoc1 = emitSkip(1);
+      emitComment("while: jump past the loop belongs here");
+   }
+   bodyLoc = emitSkip(0);
+   cGen(tree->child[1]);
+   if (jumpFalse == NULL) /* endless loop */
+      emitRM_Abs("LDA", pc, bodyLoc, "while: jmp back to body");
+   else
+   {
+      genCond(tree->child[0]);
+      emitRM_Abs(invertJump(jumpFalse), ac, bodyLoc, "while: jmp back to body");
+      currentLoc = emitSkip(0);
+      emitBackup(savedLoc1);
+      emitRM_Abs(jumpFalse, ac, currentLoc, "while: jmp past the loop");
+      emitRestore();
+   }
+   if (TraceCode)
+      emitComment("<- while");
+}
+
 /*
 função que gera código para instruções de sentença como read, write, if, repeat e atribuição
 */
@@ -74,6 +718,11 @@ static void genStmt(TreeNode *tree)
 
       break; /* switch_k */
    case IfK:
+      if (OptLevel > 0)
+      {
+         genIf(tree);
+         break;
+      }
       if (TraceCode)
          emitComment("-> if");
       p1 = tree->child[0];
@@ -102,6 +751,18 @@ static void genStmt(TreeNode *tree)
       break; /* if_k */
 
    case RepeatK:
+      if (OptLevel > 0)
+      {
+         if ((OptLevel > 1) && (numPromoted == 0))
+         {
+            promoteVars(tree);
+            genRepeat(tree);
+            releaseVars();
+         }
+         else
+            genRepeat(tree);
+         break;
+      }
       if (TraceCode)
          emitComment("-> repeat");
       // cria dois ponteiros para os filhos do repeat
@@ -124,6 +785,18 @@ static void genStmt(TreeNode *tree)
       break; /* repeat */
 
    case WhileK:
+      if (OptLevel > 0)
+      {
+         if ((OptLevel > 1) && (numPromoted == 0))
+         {
+            promoteVars(tree);
+            genWhile(tree);
+            releaseVars();
+         }
+         else
+            genWhile(tree);
+         break;
+      }
       if (TraceCode)
          emitComment("-> while");
       p1 = tree->child[0];
@@ -147,18 +820,41 @@ static void genStmt(TreeNode *tree)
    case AssignK:
       if (TraceCode)
          emitComment("-> assign");
+      loc = promotedReg(tree->memloc);
+      if (loc >= 0)
+      { /* promoted variable: compute straight into its register */
+         p1 = tree->child[0];
+         if ((p1->kind.exp == OpK) && (arithOp(p1->attr.op) != NULL))
+         {
+            traverseTree(p1, noLabel, labelNode);
+            genBinary(p1, ac, loc, arithOp(p1->attr.op), "assign: compute into register");
+         }
+         else
+         {
+            cGen(p1);
+            emitRM("LDA", loc, 0, ac, "assign: move to register");
+         }
+         if (TraceCode)
+            emitComment("<- assign");
+         break;
+      }
       /* generate code for rhs */
       cGen(tree->child[0]);
       /* now store value */
-      loc = st_lookup(tree->attr.name);
+      loc = tree->memloc;
       emitRM("ST", ac, loc, gp, "assign: store value");
       if (TraceCode)
          emitComment("<- assign");
       break; /* assign_k */
 
    case ReadK:
+      if (promotedReg(tree->memloc) >= 0)
+      {
+         emitRO("IN", promotedReg(tree->memloc), 0, 0, "read integer value into register");
+         break;
+      }
       emitRO("IN", ac, 0, 0, "read integer value");
-      loc = st_lookup(tree->attr.name);
+      loc = tree->memloc;
       emitRM("ST", ac, loc, gp, "read: store value");
       break;
    case WriteK:
@@ -175,88 +871,19 @@ static void genStmt(TreeNode *tree)
 /* Procedure genExp generates code at an expression node */
 static void genExp(TreeNode *tree)
 {
-   int loc;
-   TreeNode *p1, *p2;
-   switch (tree->kind.exp)
-   {
-
-   case ConstK:
-      if (TraceCode)
-         emitComment("-> Const");
-      /* gen code to load integer constant using LDC */
-      emitRM("LDC", ac, tree->attr.val, 0, "load const");
-      if (TraceCode)
-         emitComment("<- Const");
-      break; /* ConstK */
-
-   case IdK:
-      if (TraceCode)
-         emitComment("-> Id");
-      loc = st_lookup(tree->attr.name);
-      emitRM("LD", ac, loc, gp, "load id value");
-      if (TraceCode)
-         emitComment("<- Id");
-      break; /* IdK */
-
-   case OpK:
-      if (TraceCode)
-         emitComment("-> Op");
-      p1 = tree->child[0];
-      p2 = tree->child[1];
-      /* gen code for ac = left arg */
-      cGen(p1);
-      /* gen code to push left operand */
-      emitRM("ST", ac, tmpOffset--, mp, "op: push left");
-      /* gen code for ac = right operand */
-      cGen(p2);
-      /* now load left operand */
-      emitRM("LD", ac1, ++tmpOffset, mp, "op: load left");
-      switch (tree->attr.op)
-      {
-      case PLUS:
-         emitRO("ADD", ac, ac1, ac, "op +");
-         break;
-      case MINUS:
-         emitRO("SUB", ac, ac1, ac, "op -");
-         break;
-      case TIMES:
-         emitRO("MUL", ac, ac1, ac, "op *");
-         break;
-      case OVER:
-         emitRO("DIV", ac, ac1, ac, "op /");
-         break;
-      case LT:
-         emitRO("SUB", ac, ac1, ac, "op <");
-         emitRM("JLT", ac, 2, pc, "br if true");
-         emitRM("LDC", ac, 0, ac, "false case");
-         emitRM("LDA", pc, 1, pc, "unconditional jmp");
-         emitRM("LDC", ac, 1, ac, "true case");
-         break;
-      case EQ:
-         emitRO("SUB", ac, ac1, ac, "op ==");
-         emitRM("JEQ", ac, 2, pc, "br if true");
-         emitRM("LDC", ac, 0, ac, "false case");
-         emitRM("LDA", pc, 1, pc, "unconditional jmp");
-         emitRM("LDC", ac, 1, ac, "true case");
-         break;
-      default:
-         emitComment("BUG: Unknown operator");
-         break;
-      } /* case op */
-      if (TraceCode)
-         emitComment("<- Op");
-      break; /* OpK */
-
-   default:
-      break;
-   }
+   pushTask(gExp, tree, ac);
+   runTasks();
 } /* genExp */
 
-/* gera recursivamente código pelo percurso na árvore
+/* gera código pelo percurso na árvore: a recursão acontece apenas nos
+filhos das sentenças (profundidade de aninhamento), enquanto a lista de
+irmãos é percorrida por iteração e as expressões por uma pilha explícita
+(runTasks), para que sequências longas de sentenças e expressões longas
+não aumentem a pilha
  */
 static void cGen(TreeNode *tree)
 {
-   if (tree != NULL)
+   while (tree != NULL)
    {
       switch (tree->nodekind)
       {
@@ -264,12 +891,18 @@ static void cGen(TreeNode *tree)
          genStmt(tree); // chama essa função para gerar código para esse nó
          break;
       case ExpK:  // se for expressão
-         genExp(tree);
+         if (OptLevel > 0)
+         { // com -O as temporárias ficam em registradores
+            traverseTree(tree, noLabel, labelNode);
+            genExpReg(tree, ac);
+         }
+         else
+            genExp(tree);
          break;
       default:
          break;
       }
-      cGen(tree->sibling); // chama recursivamente cgen passando o nó irmão como argumento
+      tree = tree->sibling; // passa para o nó irmão
    }
 }
 
@@ -299,4 +932,5 @@ void codeGen(TreeNode *syntaxTree, char *codefile)
    /* finish */
    emitComment("End of execution.");
    emitRO("HALT", 0, 0, 0, "");
+   free(s);
 }
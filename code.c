@@ -2,12 +2,63 @@
 /* File: code.c                                     */
 /* TM Code emitting utilities                       */
 /* implementation for the TINY compiler             */
+/* Instructions are kept in memory and written to   */
+/* the code file once, by writeCode                 */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
 
 #include "globals.h"
+#include "util.h"
 #include "code.h"
+#include "tmb.h"
+
+/* TM opcodes, in the order of the TM simulator */
+typedef enum
+{ opHALT, opIN, opOUT, opADD, opSUB, opMUL, opDIV,
+  opLD, opST, opLDA, opLDC,
+  opJLT, opJLE, opJGT, opJGE, opJEQ, opJNE,
+  opNONE /* skipped location, never filled */
+} OpCode;
+
+static char * opName[] =
+{ "HALT", "IN", "OUT", "ADD", "SUB", "MUL", "DIV",
+  "LD", "ST", "LDA", "LDC",
+  "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE" };
+
+/* opcode numbers of the binary object format */
+static int tmbOp[] =
+{ 0, 1, 2, 3, 4, 5, 6,
+  8, 9, 11, 12,
+  13, 14, 15, 16, 17, 18 };
+
+#define ISRM(op) ((op) >= opLD)
+#define ISJUMP(op) ((op) >= opJLT)
+
+/* An instruction of the code buffer; for RM
+ * instructions s is the offset and t the base
+ * register. Comments must be static strings
+ */
+typedef struct
+{ OpCode op;
+  int r, s, t;
+  char * comment;
+} Instr;
+
+/* A comment line, printed before the
+ * instruction at location loc
+ */
+typedef struct
+{ int loc;
+  int seq; /* emission order, for sorting */
+  char * text;
+} Comment;
+
+/* the code buffer */
+static Instr * instrs = NULL;
+static int instrSize = 0;
+static Comment * comments = NULL;
+static int numComments = 0, commentSize = 0;
 
 /* TM location number for current instruction emission */
 static int emitLoc = 0 ;
@@ -17,11 +68,59 @@ static int emitLoc = 0 ;
    emitBackup, and emitRestore */
 static int highEmitLoc = 0;
 
-/* Procedure emitComment prints a comment line 
+/* Procedure reserve makes room in the code
+ * buffer for locations up to loc
+ */
+static void reserve( int loc )
+{ if (loc >= instrSize)
+  { int size = (instrSize == 0) ? 1024 : instrSize;
+    int i;
+    Instr * p;
+    while (loc >= size) size *= 2;
+    p = (Instr *) realloc(instrs, size * sizeof(Instr));
+    if (p == NULL)
+    { fprintf(listing,"Out of memory error generating code\n");
+      exit(1);
+    }
+    for (i = instrSize; i < size; i++) p[i].op = opNONE;
+    instrs = p;
+    instrSize = size;
+  }
+}
+
+/* Procedure store puts an instruction at the
+ * current location and advances it
+ */
+static void store( char * op, int r, int s, int t, char * c )
+{ OpCode o = opHALT;
+  while ((o < opNONE) && (strcmp(opName[o], op) != 0)) o++;
+  reserve(emitLoc);
+  instrs[emitLoc].op = o;
+  instrs[emitLoc].r = r;
+  instrs[emitLoc].s = s;
+  instrs[emitLoc].t = t;
+  instrs[emitLoc].comment = c;
+  ++emitLoc;
+  if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
+}
+
+/* Procedure emitComment prints a comment line
  * with comment c in the code file
  */
 void emitComment( char * c )
-{ if (TraceCode) fprintf(code,"* %s\n",c);}
+{ if (!TraceCode) return;
+  if (numComments == commentSize)
+  { int size = (commentSize == 0) ? 256 : commentSize * 2;
+    Comment * p = (Comment *) realloc(comments, size * sizeof(Comment));
+    if (p == NULL) return;
+    comments = p;
+    commentSize = size;
+  }
+  comments[numComments].loc = emitLoc;
+  comments[numComments].seq = numComments;
+  comments[numComments].text = copyString(c);
+  numComments++;
+}
 
 /* Procedure emitRO emits a register-only
  * TM instruction
@@ -32,10 +131,7 @@ void emitComment( char * c )
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRO( char *op, int r, int s, int t, char *c)
-{ fprintf(code,"%3d:  %5s  %d,%d,%d ",emitLoc++,op,r,s,t);
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
+{ store(op,r,s,t,c);
 } /* emitRO */
 
 /* Procedure emitRM emits a register-to-memory
@@ -47,10 +143,7 @@ void emitRO( char *op, int r, int s, int t, char *c)
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRM( char * op, int r, int d, int s, char *c)
-{ fprintf(code,"%3d:  %5s  %d,%d(%d) ",emitLoc++,op,r,d,s);
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc)  highEmitLoc = emitLoc ;
+{ store(op,r,d,s,c);
 } /* emitRM */
 
 /* Function emitSkip skips "howMany" code
@@ -64,7 +157,7 @@ int emitSkip( int howMany)
    return i;
 } /* emitSkip */
 
-/* Procedure emitBackup backs up to 
+/* Procedure emitBackup backs up to
  * loc = a previously skipped location
  */
 void emitBackup( int loc)
@@ -72,14 +165,20 @@ void emitBackup( int loc)
   emitLoc = loc ;
 } /* emitBackup */
 
-/* Procedure emitRestore restores the current 
+/* Procedure emitRestore restores the current
  * code position to the highest previously
  * unemitted position
  */
 void emitRestore(void)
 { emitLoc = highEmitLoc;}
 
-/* Procedure emitRM_Abs converts an absolute reference 
+/* Function emitCount returns the number of
+ * code locations emitted so far
+ */
+int emitCount(void)
+{ return highEmitLoc;}
+
+/* Procedure emitRM_Abs converts an absolute reference
  * to a pc-relative reference when emitting a
  * register-to-memory TM instruction
  * op = the opcode
@@ -88,10 +187,241 @@ void emitRestore(void)
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRM_Abs( char *op, int r, int a, char * c)
-{ fprintf(code,"%3d:  %5s  %d,%d(%d) ",
-               emitLoc,op,r,a-(emitLoc+1),pc);
-  ++emitLoc ;
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
+{ store(op,r,a-(emitLoc+1),pc,c);
 } /* emitRM_Abs */
+
+/**************************************************/
+/*************   Peephole optimizer   *************/
+/**************************************************/
+
+/* TRUE if the instruction at i jumps (or takes an
+ * address) relative to the pc; its target is then
+ * i+1+offset
+ */
+#define PCREL(i) (((instrs[i].op == opLDA) || ISJUMP(instrs[i].op)) && \
+                  (instrs[i].t == pc))
+#define TARGET(i) ((i) + 1 + instrs[i].s)
+
+/* TRUE if the instruction at i always jumps */
+#define GOTO(i) ((instrs[i].op == opLDA) && (instrs[i].r == pc) && \
+                 (instrs[i].t == pc))
+
+/* TRUE if execution never goes on from i to i+1
+ * (an unfilled location holds a HALT in the TM)
+ */
+#define STOPS(i) ((instrs[i].op == opHALT) || (instrs[i].op == opNONE) || GOTO(i))
+
+/* Function fixedJump tells whether the instruction
+ * at i changes the pc other than by a pc-relative
+ * jump; code with such instructions cannot be moved
+ */
+static int fixedJump( int i )
+{ if ((instrs[i].op == opNONE) || PCREL(i)) return FALSE;
+  return ISJUMP(instrs[i].op) || (instrs[i].r == pc);
+}
+
+/* Procedure removeInstrs deletes the instructions
+ * marked in dead, moving the rest down and
+ * re-linking pc-relative offsets and comments.
+ * A reference to a deleted instruction goes to the
+ * next instruction kept
+ */
+static void removeInstrs( char * dead )
+{ int * newLoc = (int *) malloc((highEmitLoc + 1) * sizeof(int));
+  int i, n = 0;
+  if (newLoc == NULL) return;
+  for (i = 0; i < highEmitLoc; i++)
+  { newLoc[i] = n;
+    if (!dead[i]) n++;
+  }
+  newLoc[highEmitLoc] = n;
+  for (i = 0; i < highEmitLoc; i++)
+    if (!dead[i])
+    { if (PCREL(i) && (TARGET(i) >= 0) && (TARGET(i) <= highEmitLoc))
+        instrs[i].s = newLoc[TARGET(i)] - (newLoc[i] + 1);
+      instrs[newLoc[i]] = instrs[i];
+    }
+  for (i = 0; i < numComments; i++)
+    if (comments[i].loc <= highEmitLoc)
+      comments[i].loc = newLoc[comments[i].loc];
+  for (i = n; i < highEmitLoc; i++) instrs[i].op = opNONE;
+  highEmitLoc = emitLoc = n;
+  free(newLoc);
+}
+
+/* MAXPASSES bounds the rounds of the peephole
+ * optimizer (each round may enable more changes)
+ */
+#define MAXPASSES 8
+
+/* Function peephole improves the code buffer:
+ * jumps to unconditional jumps go straight to the
+ * final target, jumps to the next instruction are
+ * removed, a load right after a store to the same
+ * location is taken from the stored register, and
+ * code that cannot be reached is deleted. It
+ * returns the number of instructions removed
+ */
+int peephole(void)
+{ char * target;
+  char * dead;
+  int i, pass, removed = 0, changed = TRUE;
+  for (i = 0; i < highEmitLoc; i++)
+    if (fixedJump(i)) return 0;
+  target = (char *) malloc(highEmitLoc + 1);
+  dead = (char *) malloc(highEmitLoc + 1);
+  if ((target == NULL) || (dead == NULL))
+  { free(target);
+    free(dead);
+    return 0;
+  }
+  for (pass = 0; changed && (pass < MAXPASSES); pass++)
+  { int reachable = TRUE, any = FALSE;
+    changed = FALSE;
+    /* jump threading */
+    for (i = 0; i < highEmitLoc; i++)
+      if (PCREL(i) && ((instrs[i].r == pc) || ISJUMP(instrs[i].op)))
+      { int t = TARGET(i), hops = 0;
+        while ((t >= 0) && (t < highEmitLoc) && GOTO(t) &&
+               (TARGET(t) != t) && (hops++ < 16))
+          t = TARGET(t);
+        if (t != TARGET(i))
+        { instrs[i].s = t - (i + 1);
+          changed = TRUE;
+        }
+      }
+    memset(target,0,highEmitLoc + 1);
+    memset(dead,0,highEmitLoc + 1);
+    for (i = 0; i < highEmitLoc; i++)
+      if (PCREL(i) && (TARGET(i) >= 0) && (TARGET(i) <= highEmitLoc))
+        target[TARGET(i)] = TRUE;
+    for (i = 0; i < highEmitLoc; i++)
+    { Instr * in = &instrs[i];
+      if (i > 0)
+        reachable = target[i] || (reachable && !STOPS(i-1));
+      if (!reachable)
+        dead[i] = TRUE;
+      /* jump to the next instruction */
+      else if (PCREL(i) && ((in->r == pc) || ISJUMP(in->op)) && (in->s == 0))
+        dead[i] = TRUE;
+      /* store-load forwarding: ST r,d(b) ; LD r2,d(b) */
+      else if ((in->op == opLD) && (i > 0) && !target[i] && (in->t != pc) &&
+               (instrs[i-1].op == opST) && (instrs[i-1].s == in->s) &&
+               (instrs[i-1].t == in->t))
+      { if (in->r == instrs[i-1].r)
+          dead[i] = TRUE;
+        else
+        { in->op = opLDA;
+          in->s = 0;
+          in->t = instrs[i-1].r;
+          changed = TRUE;
+        }
+      }
+      if (dead[i]) any = TRUE;
+    }
+    if (any)
+    { int before = highEmitLoc;
+      removeInstrs(dead);
+      removed += before - highEmitLoc;
+      changed = TRUE;
+    }
+  }
+  free(target);
+  free(dead);
+  return removed;
+}
+
+/* compares comments by location, then by
+ * emission order
+ */
+static int commentOrder( const void * a, const void * b )
+{ const Comment * x = (const Comment *) a;
+  const Comment * y = (const Comment *) b;
+  if (x->loc != y->loc) return x->loc - y->loc;
+  return x->seq - y->seq;
+}
+
+/* Procedure freeCode empties the code buffer */
+static void freeCode(void)
+{ free(instrs);
+  free(comments);
+  instrs = NULL;
+  comments = NULL;
+  instrSize = numComments = commentSize = 0;
+}
+
+/* Procedure writeCode writes the code buffer to
+ * the code file, in location order, and empties it
+ */
+void writeCode(void)
+{ int i, c = 0;
+  qsort(comments,numComments,sizeof(Comment),commentOrder);
+  for (i = 0; i <= highEmitLoc; i++)
+  { Instr * in;
+    while (c < numComments && comments[c].loc <= i)
+      fprintf(code,"* %s\n",comments[c++].text);
+    if (i == highEmitLoc) break;
+    in = &instrs[i];
+    if (in->op == opNONE) continue;
+    if (ISRM(in->op))
+      fprintf(code,"%3d:  %5s  %d,%d(%d) ",i,opName[in->op],in->r,in->s,in->t);
+    else
+      fprintf(code,"%3d:  %5s  %d,%d,%d ",i,opName[in->op],in->r,in->s,in->t);
+    if (TraceCode) fprintf(code,"\t%s",in->comment) ;
+    fprintf(code,"\n") ;
+  }
+  while (c < numComments)
+    fprintf(code,"* %s\n",comments[c++].text);
+  freeCode();
+}
+
+/* Procedure put32 writes n to the code file as a
+ * 32-bit little endian integer
+ */
+static void put32( unsigned long n )
+{ putc((int)(n & 0xff),code);
+  putc((int)((n >> 8) & 0xff),code);
+  putc((int)((n >> 16) & 0xff),code);
+  putc((int)((n >> 24) & 0xff),code);
+}
+
+/* Procedure writeObject writes the code buffer to
+ * the code file in the binary format of tmb.h and
+ * empties it. Skipped locations become HALT 0,0,0,
+ * as in the TM; instruction comments go to the
+ * debug section if TraceCode is TRUE
+ */
+void writeObject(void)
+{ unsigned long debugSize = 0;
+  int i;
+  if (TraceCode)
+    for (i = 0; i < highEmitLoc; i++)
+      debugSize += (instrs[i].op == opNONE) ? 1 : strlen(instrs[i].comment) + 1;
+  fwrite(TMB_MAGIC,1,4,code);
+  put32(TMB_VERSION);
+  put32(highEmitLoc);
+  put32(0); /* no initialized data */
+  put32(debugSize);
+  for (i = 0; i < highEmitLoc; i++)
+  { Instr * in = &instrs[i];
+    if (in->op == opNONE)
+    { put32(0);
+      put32(0);
+      continue;
+    }
+    putc(tmbOp[in->op],code);
+    putc(in->r,code);
+    putc(in->t,code);
+    putc(0,code);
+    put32((unsigned long) in->s);
+  }
+  if (TraceCode)
+  { for (i = 0; i < highEmitLoc; i++)
+    { if (instrs[i].op == opNONE)
+        putc(0,code);
+      else
+        fwrite(instrs[i].comment,1,strlen(instrs[i].comment) + 1,code);
+    }
+  }
+  freeCode();
+}
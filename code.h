@@ -29,6 +29,12 @@
 /* 2nd accumulator */
 #define  ac1 1
 
+/* registers ac to maxreg hold the temporaries
+ * of expressions when they are allocated to
+ * registers (-O); 2 to 4 are otherwise unused
+ */
+#define  maxreg 4
+
 /* code emitting utilities */
 
 /* Procedure emitComment prints a comment line 
@@ -73,6 +79,11 @@ void emitBackup( int loc);
  */
 void emitRestore(void);
 
+/* Function emitCount returns the number of
+ * code locations emitted so far
+ */
+int emitCount(void);
+
 /* Procedure emitRM_Abs converts an absolute reference 
  * to a pc-relative reference when emitting a
  * register-to-memory TM instruction
@@ -83,4 +94,24 @@ void emitRestore(void);
  */
 void emitRM_Abs( char *op, int r, int a, char * c);
 
+/* Function peephole improves the emitted code
+ * (jump threading, removal of jumps to the next
+ * instruction and of unreachable code, store-load
+ * forwarding), re-linking the pc-relative jumps,
+ * and returns the number of instructions removed
+ */
+int peephole(void);
+
+/* Procedure writeCode writes the emitted code to
+ * the code file; until then it is kept in memory
+ * so that backpatching and peephole can change it
+ */
+void writeCode(void);
+
+/* Procedure writeObject writes the emitted code to
+ * the code file in the binary format of tmb.h,
+ * instead of writeCode
+ */
+void writeObject(void);
+
 #endif
@@ -0,0 +1,111 @@
+#!/bin/sh
+# File: difftest.sh
+# Differential test of the TM engines: every TINY
+# program is compiled at -O0, -O1 and -O2, as text
+# and as a binary object (.tmb), and run with
+# tm -run, tm -jit -run and the C translation of
+# tm -c; stdout, stderr and the exit status of each
+# run must match those of tm -run on the text code
+#
+# usage: ./difftest.sh [file.tny ...]
+# (default: the example*.tny programs and the
+# corpus/*.tny programs)
+#
+# The input of prog.tny is read from prog.in when
+# that file exists, otherwise a fixed list of
+# numbers is used. CC and CFLAGS choose the C
+# compiler for the tools (built with -Wall) and
+# the translated code;
+# each run is stopped after LIMIT seconds (where
+# timeout(1) exists); KEEP=1 keeps the work
+# directory
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-O2"}
+LIMIT=${LIMIT:-10}
+top=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d "${TMPDIR:-/tmp}/difftest.XXXXXX") || exit 1
+[ -n "$KEEP" ] || trap 'rm -rf "$work"' 0
+trap 'exit 1' 1 2 15
+
+if [ $# -eq 0 ]; then
+  set -- "$top"/example*.tny "$top"/corpus/*.tny
+fi
+
+# build the compiler and the simulator
+$CC $CFLAGS -Wall -o "$work/tiny" $(ls "$top"/*.c | grep -v '/tm\.c$') || exit 1
+$CC $CFLAGS -Wall -o "$work/tm" "$top/tm.c" || exit 1
+
+limit=
+if command -v timeout > /dev/null 2>&1; then
+  limit="timeout $LIMIT"
+fi
+
+printf '3\n1\n4\n1\n5\n9\n2\n6\n' > "$work/default.in"
+
+fail=0
+runs=0
+
+# run name cmd...: output of cmd into $work/run/name.{out,err,st};
+# the program name that starts a fault message is dropped, since it
+# differs between prog.tm and prog.tmb
+run()
+{
+  name=$1
+  shift
+  $limit "$@" < "$input" > "$work/run/$name.out" 2> "$work/run/stderr"
+  echo $? > "$work/run/$name.st"
+  sed 's/^[^:]*: //' "$work/run/stderr" > "$work/run/$name.err"
+}
+
+# check name: compare a run against the reference run
+check()
+{
+  runs=$((runs + 1))
+  for part in out err st; do
+    if ! cmp -s "$work/run/ref.$part" "$work/run/$1.$part"; then
+      echo "FAIL $prog $opt $1 ($part)"
+      diff "$work/run/ref.$part" "$work/run/$1.$part" | head -10
+      fail=$((fail + 1))
+      return
+    fi
+  done
+}
+
+for src in "$@"; do
+  prog=$(basename "$src" .tny)
+  input=${src%.tny}.in
+  [ -f "$input" ] || input="$work/default.in"
+  for opt in -O0 -O1 -O2; do
+    rm -rf "$work/run"
+    mkdir "$work/run"
+    cp "$src" "$work/run/$prog.tny"
+    if ! "$work/tiny" -quiet $opt -o "$work/run/$prog.tm" "$work/run/$prog.tny" \
+         > "$work/run/tiny.log" 2>&1 ||
+       [ ! -f "$work/run/$prog.tm" ]; then
+      echo "FAIL $prog $opt: tiny did not compile it"
+      fail=$((fail + 1))
+      continue
+    fi
+    "$work/tiny" -quiet -tmb $opt -o "$work/run/$prog.tmb" "$work/run/$prog.tny" \
+      > /dev/null 2>&1
+    run ref "$work/tm" -run "$work/run/$prog.tm"
+    run tmb "$work/tm" -run "$work/run/$prog.tmb"
+    check tmb
+    run jit "$work/tm" -jit -run "$work/run/$prog.tm"
+    check jit
+    run jit-tmb "$work/tm" -jit -run "$work/run/$prog.tmb"
+    check jit-tmb
+    if "$work/tm" -c "$work/run/$prog.tm" > /dev/null 2>&1 &&
+       $CC $CFLAGS -o "$work/run/$prog.exe" "$work/run/$prog.c"; then
+      run c "$work/run/$prog.exe"
+      check c
+    else
+      echo "FAIL $prog $opt c: the translation did not build"
+      fail=$((fail + 1))
+    fi
+  done
+done
+
+echo "$runs runs, $fail failures"
+[ $fail -eq 0 ]
@@ -0,0 +1,206 @@
+/****************************************************/
+/* File: flat.c                                     */
+/* Flat syntax tree implementation                  */
+/* for the TINY compiler                            */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "flat.h"
+
+/* Function newFlatNode appends an uninitialized
+ * node to ft and returns its index
+ */
+static unsigned int newFlatNode(FlatTree *ft)
+{
+  if (ft->count == ft->capacity)
+  {
+    unsigned int cap = (ft->capacity == 0) ? 1024 : ft->capacity * 2;
+    FlatNode *nodes = (FlatNode *)realloc(ft->nodes, cap * sizeof(FlatNode));
+    TreeNode **origin = (nodes == NULL) ? NULL : (TreeNode **)realloc(ft->origin, cap * sizeof(TreeNode *));
+    if (nodes != NULL)
+      ft->nodes = nodes;
+    if (origin == NULL)
+    {
+      fprintf(listing, "Out of memory error flattening syntax tree\n");
+      exit(1);
+    }
+    ft->origin = origin;
+    ft->capacity = cap;
+  }
+  return ft->count++;
+}
+
+/* flat tree under construction and stack of the
+ * indices of the nodes whose subtree is still open,
+ * used by the flattenPre/flattenPost callbacks
+ */
+static FlatTree *building;
+static unsigned int *openNodes;
+static unsigned int openCount, openSize;
+
+/* appends the flat form of t (whose children
+ * follow) and marks it open
+ */
+static void flattenPre(TreeNode *t)
+{
+  unsigned int i = newFlatNode(building);
+  unsigned int header;
+  int k, kind, attr;
+  if (t->nodekind == StmtK)
+  {
+    kind = t->kind.stmt;
+    attr = ((kind == AssignK) || (kind == ReadK)) ? t->attr.atom : 0;
+  }
+  else
+  {
+    kind = t->kind.exp;
+    if (kind == OpK)
+      attr = t->attr.op;
+    else if (kind == ConstK)
+      attr = t->attr.val;
+    else
+      attr = t->attr.atom;
+  }
+  header = (unsigned int)t->nodekind | ((unsigned int)kind << 1);
+  if (t->nodekind == ExpK)
+    header = FN_SETTYPE(header, t->type);
+  if (t->sibling != NULL)
+    header |= 1u << 10;
+  for (k = 0; k < MAXCHILDREN; k++)
+    if (t->child[k] != NULL)
+      header |= 1u << (7 + k);
+  building->nodes[i].header = header;
+  building->nodes[i].lineno = t->lineno;
+  building->nodes[i].attr = attr;
+  building->origin[i] = t;
+  if (openCount == openSize)
+  {
+    openSize = (openSize == 0) ? 64 : openSize * 2;
+    openNodes = (unsigned int *)realloc(openNodes, openSize * sizeof(unsigned int));
+    if (openNodes == NULL)
+    {
+      fprintf(listing, "Out of memory error flattening syntax tree\n");
+      exit(1);
+    }
+  }
+  openNodes[openCount++] = i;
+}
+
+/* closes the subtree of the innermost open node */
+static void flattenPost(TreeNode *t)
+{
+  building->nodes[openNodes[--openCount]].end = building->count;
+}
+
+/* Function flattenTree builds the flat form of
+ * a syntax tree
+ */
+FlatTree *flattenTree(TreeNode *t)
+{
+  FlatTree *ft = (FlatTree *)malloc(sizeof(FlatTree));
+  if (ft == NULL)
+  {
+    fprintf(listing, "Out of memory error flattening syntax tree\n");
+    exit(1);
+  }
+  ft->nodes = NULL;
+  ft->origin = NULL;
+  ft->count = ft->capacity = 0;
+  building = ft;
+  traverseTree(t, flattenPre, flattenPost);
+  free(openNodes);
+  openNodes = NULL;
+  openCount = openSize = 0;
+  return ft;
+}
+
+/* Procedure freeFlatTree releases a flat tree */
+void freeFlatTree(FlatTree *ft)
+{
+  if (ft != NULL)
+  {
+    free(ft->nodes);
+    free(ft->origin);
+    free(ft);
+  }
+}
+
+/* Function flatSibling returns the index of the
+ * sibling of node i, or FLAT_NULL
+ */
+unsigned int flatSibling(FlatTree *ft, unsigned int i)
+{
+  return FN_HASSIBLING(ft->nodes[i].header) ? ft->nodes[i].end : FLAT_NULL;
+}
+
+/* Function flatChild returns the index of child
+ * k of node i, or FLAT_NULL
+ */
+unsigned int flatChild(FlatTree *ft, unsigned int i, int k)
+{
+  int mask = FN_CHILDMASK(ft->nodes[i].header);
+  unsigned int c = i + 1;
+  int j;
+  if (!(mask & (1 << k)))
+    return FLAT_NULL;
+  for (j = 0; j < k; j++)
+    if (mask & (1 << j))
+    { /* skip the whole chain of child j */
+      while (FN_HASSIBLING(ft->nodes[c].header))
+        c = ft->nodes[c].end;
+      c = ft->nodes[c].end;
+    }
+  return c;
+}
+
+/* Procedure flatTraverse visits the flat tree in
+ * one linear scan. A node is still "open" until
+ * the scan reaches its end index, so postProc is
+ * applied to the open nodes that end before each
+ * new node; the stack holds only the open nodes,
+ * so its depth is the nesting depth of the tree
+ */
+void flatTraverse(FlatTree *ft,
+                  void (*preProc)(FlatTree *, unsigned int),
+                  void (*postProc)(FlatTree *, unsigned int))
+{
+  unsigned int *stack;
+  unsigned int sp = 0, size = 64, i;
+  stack = (unsigned int *)malloc(size * sizeof(unsigned int));
+  if (stack == NULL)
+    return;
+  for (i = 0; i < ft->count; i++)
+  {
+    while ((sp > 0) && (ft->nodes[stack[sp - 1]].end <= i))
+      postProc(ft, stack[--sp]);
+    preProc(ft, i);
+    if (sp == size)
+    {
+      unsigned int *s = (unsigned int *)realloc(stack, 2 * size * sizeof(unsigned int));
+      if (s == NULL)
+        break;
+      stack = s;
+      size *= 2;
+    }
+    stack[sp++] = i;
+  }
+  while (sp > 0)
+    postProc(ft, stack[--sp]);
+  free(stack);
+}
+
+/* Procedure printFlatStats prints node count and
+ * bytes per node of the flat and pointer trees; a
+ * flat node also carries its origin pointer
+ */
+void printFlatStats(FlatTree *ft)
+{
+  int flatSize = (int)(sizeof(FlatNode) + sizeof(TreeNode *));
+  fprintf(listing, "\nFlat syntax tree: %u nodes\n", ft->count);
+  fprintf(listing, "  flat:    %3d bytes/node, %10lu bytes (%d + %d origin)\n",
+          flatSize, (unsigned long)ft->count * flatSize,
+          (int)sizeof(FlatNode), (int)sizeof(TreeNode *));
+  fprintf(listing, "  pointer: %3d bytes/node, %10lu bytes\n",
+          (int)sizeof(TreeNode), (unsigned long)ft->count * sizeof(TreeNode));
+}
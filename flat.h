@@ -0,0 +1,78 @@
+/****************************************************/
+/* File: flat.h                                     */
+/* Flat syntax tree for the TINY compiler: nodes    */
+/* stored in preorder in one contiguous vector and  */
+/* addressed by 32-bit indices                      */
+/****************************************************/
+
+#ifndef _FLAT_H_
+#define _FLAT_H_
+
+/* FlatNode is the flat form of a TreeNode. The
+ * children of a node follow it directly in the
+ * vector (child chains in order, each child
+ * followed by its own siblings), and its next
+ * sibling, if any, starts at index end
+ */
+typedef struct
+{
+  unsigned int header; /* nodekind, kind, type, child mask, sibling bit */
+  int lineno;
+  int attr;         /* op, val or atom, as in TreeNode.attr */
+  unsigned int end; /* index one past the node's subtree */
+} FlatNode;
+
+/* header word layout */
+#define FN_NODEKIND(h) ((NodeKind)((h)&1))
+#define FN_KIND(h) ((int)(((h) >> 1) & 15))
+#define FN_TYPE(h) ((ExpType)(((h) >> 5) & 3))
+#define FN_CHILDMASK(h) ((int)(((h) >> 7) & 7))
+#define FN_HASSIBLING(h) (((h) >> 10) & 1)
+#define FN_SETTYPE(h, t) (((h) & ~(3u << 5)) | ((unsigned int)(t) << 5))
+
+/* FLAT_NULL marks a missing child or sibling */
+#define FLAT_NULL 0xFFFFFFFFu
+
+typedef struct
+{
+  FlatNode *nodes;
+  TreeNode **origin; /* the pointer-tree node of each flat node */
+  unsigned int count;
+  unsigned int capacity;
+} FlatTree;
+
+/* Function flattenTree builds the flat form of
+ * a syntax tree; the result is freed with
+ * freeFlatTree
+ */
+FlatTree *flattenTree(TreeNode *);
+
+/* Procedure freeFlatTree releases a flat tree */
+void freeFlatTree(FlatTree *);
+
+/* Function flatChild returns the index of child
+ * k of node i, or FLAT_NULL
+ */
+unsigned int flatChild(FlatTree *, unsigned int i, int k);
+
+/* Function flatSibling returns the index of the
+ * sibling of node i, or FLAT_NULL
+ */
+unsigned int flatSibling(FlatTree *, unsigned int i);
+
+/* Procedure flatTraverse visits the flat tree in
+ * one linear scan, applying preProc in preorder
+ * and postProc in postorder (the same order as
+ * a recursive traversal of the pointer tree)
+ */
+void flatTraverse(FlatTree *,
+                  void (*preProc)(FlatTree *, unsigned int),
+                  void (*postProc)(FlatTree *, unsigned int));
+
+/* Procedure printFlatStats prints node count and
+ * bytes per node of the flat tree (with its origin
+ * array) and of the pointer tree to the listing file
+ */
+void printFlatStats(FlatTree *);
+
+#endif
@@ -22,8 +22,32 @@
 #define TRUE 1
 #endif
 
-/*Vetor de palavras reservadas, sempre que acrescentamos uma palavra reservada ele dever ser modificado*/
-#define MAXRESERVED 10
+/* Lista única das palavras reservadas da linguagem. Cada entrada traz o
+ * token, o lexema e as letras usadas pelo hash perfeito do scanner
+ * (primeira, segunda e última). O enum TokenType, o reconhecimento de
+ * palavras reservadas em scan.c, printToken e MAXRESERVED são gerados a
+ * partir dela: para acrescentar uma palavra reservada basta uma linha aqui
+ */
+#define RESERVED_WORDS(X)                   \
+   X(IF, "if", 'i', 'f', 'f')               \
+   X(THEN, "then", 't', 'h', 'n')           \
+   X(ELSE, "else", 'e', 'l', 'e')           \
+   X(ENDIF, "endif", 'e', 'n', 'f')         \
+   X(REPEAT, "repeat", 'r', 'e', 't')       \
+   X(UNTIL, "until", 'u', 'n', 'l')         \
+   X(READ, "read", 'r', 'e', 'd')           \
+   X(WRITE, "write", 'w', 'r', 'e')         \
+   X(SWITCH, "switch", 's', 'w', 'h')       \
+   X(CASE, "case", 'c', 'a', 'e')           \
+   X(ENDSWITCH, "endswitch", 'e', 'n', 'h') \
+   X(WHILE, "while", 'w', 'h', 'e')         \
+   X(ENDWHILE, "endwhile", 'e', 'n', 'e')
+
+#define RESERVED_ENUM(tok, str, c0, c1, cn) tok,
+#define RESERVED_COUNT(tok, str, c0, c1, cn) +1
+
+/* quantidade de palavras reservadas */
+#define MAXRESERVED (0 RESERVED_WORDS(RESERVED_COUNT))
 
 typedef enum
 /* book-keeping tokens */
@@ -31,19 +55,7 @@ typedef enum
    ENDFILE,
    ERROR,
    /* reserved words */
-   IF,
-   THEN,
-   ELSE,
-   ENDIF,
-   REPEAT,
-   UNTIL,
-   READ,
-   WRITE,
-   SWITCH,
-   CASE,
-   ENDSWITCH,
-   WHILE,
-   ENDWHILE,
+   RESERVED_WORDS(RESERVED_ENUM)
    /* multicharacter tokens */
    ID,
    NUM,
@@ -121,11 +133,13 @@ typedef struct treeNode
    {
       TokenType op;
       int val;
-      char *name;
+      int atom;
    } attr;// Armazena o operador (*,+,-,...), armazena o valor inteiro no caso de 
-             //uma constante númerica, armazena uma string no caso de um identidicador
+             //uma constante númerica, armazena o átomo (ver intern.h) no caso de um identificador
    ExpType type; // armazena o tipo do nó que pode ser ou integer  ou boolean e serve para verificação de tipo e é usada caso
      // o nó seja do tipo expressão
+   int memloc; // posição de memória do identificador, resolvida uma única vez na análise semântica (-1 se não resolvida)
+   int regs; // nos operadores, quantos registradores sua avaliação exige (número de Sethi-Ullman, calculado pelo gerador de código)
 } TreeNode;
 
 /**************************************************/
@@ -160,6 +174,30 @@ extern int TraceAnalyze;
  */
 extern int TraceCode;
 
+/* PreTokenize = TRUE makes the scanner fill the
+ * whole token stream in one pass before parsing;
+ * the parser then consumes it by index
+ */
+extern int PreTokenize;
+
+/* FlatAST = TRUE makes semantic analysis run on
+ * the flat, index-based form of the syntax tree
+ * (see flat.h) and report its size statistics
+ */
+extern int FlatAST;
+
+/* CrossRef = TRUE makes the symbol table record
+ * every line in which each variable is referenced
+ * (needed by printSymTab and the cross-reference
+ * queries of symtab.h)
+ */
+extern int CrossRef;
+
+/* OptLevel > 0 enables the optimizations of the
+ * syntax tree and of the generated code (-O)
+ */
+extern int OptLevel;
+
 /* Error = TRUE prevents further passes if an error occurs */
 extern int Error;
 #endif
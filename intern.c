@@ -0,0 +1,232 @@
+/****************************************************/
+/* File: intern.c                                   */
+/* Identifier interning for the TINY compiler       */
+/* Names are kept in an open-addressing hash table  */
+/* (Robin Hood probing, power-of-two capacity that  */
+/* grows automatically); each new name receives the */
+/* next free atom number. Name text lives in the    */
+/* arena                                            */
+/****************************************************/
+
+#include "globals.h"
+#include "intern.h"
+#include "arena.h"
+
+/* INITSIZE is the initial capacity of the hash
+   table (a power of two) */
+#define INITSIZE 1024
+
+/* the table grows when more than MAXLOAD/8
+   of its slots are used */
+#define MAXLOAD 7
+
+/* the hash function: FNV-1a over the bytes,
+ * followed by a final avalanche so that the
+ * low bits used as index depend on every byte
+ */
+static unsigned int hash(const char *key, int len)
+{
+  unsigned int h = 2166136261u;
+  int i;
+  for (i = 0; i < len; i++)
+  {
+    h ^= (unsigned char)key[i];
+    h *= 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+/* A slot of the hash table: the stored hash
+ * of the name (compared before the name text)
+ * and its atom, or -1 if the slot is empty
+ */
+typedef struct
+{
+  unsigned int hash;
+  int atom;
+} Slot;
+
+/* the hash table */
+static Slot *slots = NULL;
+static unsigned int mask = 0; /* capacity - 1 */
+
+/* atom -> identifier text and length */
+static char **atomNames = NULL;
+static int *atomLens = NULL;
+static int atomsUsed = 0;
+static int atomsCapacity = 0;
+
+/* distance of the slot i from the home slot
+   of hash h */
+#define PROBEDIST(h, i) (((i) - ((h)&mask)) & mask)
+
+/* Procedure placeSlot puts (h, atom) in the
+ * table by Robin Hood insertion: an entry
+ * closer to its home slot gives way to the
+ * one being inserted
+ */
+static void placeSlot(unsigned int h, int atom)
+{
+  unsigned int i = h & mask;
+  unsigned int dist = 0;
+  for (;;)
+  {
+    Slot *s = &slots[i];
+    if (s->atom < 0)
+    {
+      s->hash = h;
+      s->atom = atom;
+      return;
+    }
+    if (PROBEDIST(s->hash, i) < dist)
+    { /* swap and go on inserting the evicted entry */
+      unsigned int th = s->hash;
+      int ta = s->atom;
+      s->hash = h;
+      s->atom = atom;
+      h = th;
+      atom = ta;
+      dist = PROBEDIST(h, i);
+    }
+    i = (i + 1) & mask;
+    dist++;
+  }
+}
+
+/* Procedure growTable doubles the capacity of
+ * the table (or creates it) and reinserts
+ * every entry
+ */
+static int growTable(void)
+{
+  Slot *old = slots;
+  unsigned int oldSize = (slots == NULL) ? 0 : mask + 1;
+  unsigned int size = (oldSize == 0) ? INITSIZE : oldSize * 2;
+  unsigned int i;
+  slots = (Slot *)malloc(size * sizeof(Slot));
+  if (slots == NULL)
+  {
+    slots = old;
+    return FALSE;
+  }
+  for (i = 0; i < size; i++)
+    slots[i].atom = -1;
+  mask = size - 1;
+  for (i = 0; i < oldSize; i++)
+    if (old[i].atom >= 0)
+      placeSlot(old[i].hash, old[i].atom);
+  free(old);
+  return TRUE;
+}
+
+/* Function lookup returns the atom of the name
+ * s of length len with hash h, or -1
+ */
+static int lookup(const char *s, int len, unsigned int h)
+{
+  unsigned int i, dist = 0;
+  if (slots == NULL)
+    return -1;
+  i = h & mask;
+  for (;;)
+  {
+    Slot *sl = &slots[i];
+    if ((sl->atom < 0) || (PROBEDIST(sl->hash, i) < dist))
+      return -1; /* a Robin Hood table would have placed it before */
+    if ((sl->hash == h) && (atomLens[sl->atom] == len) &&
+        (memcmp(atomNames[sl->atom], s, len) == 0))
+      return sl->atom;
+    i = (i + 1) & mask;
+    dist++;
+  }
+}
+
+/* Function internName returns the atom of the
+ * identifier s of length len, adding it if new
+ */
+int internName(const char *s, int len)
+{
+  unsigned int h = hash(s, len);
+  int atom = lookup(s, len, h);
+  char *name;
+  if (atom >= 0)
+    return atom;
+  if (atomsUsed == atomsCapacity)
+  {
+    int cap = (atomsCapacity == 0) ? 256 : atomsCapacity * 2;
+    char **names = (char **)realloc(atomNames, cap * sizeof(char *));
+    int *lens = (names == NULL) ? NULL : (int *)realloc(atomLens, cap * sizeof(int));
+    if (names != NULL)
+      atomNames = names;
+    if (lens == NULL)
+    {
+      fprintf(listing, "Out of memory error at line %d\n", lineno);
+      return 0;
+    }
+    atomLens = lens;
+    atomsCapacity = cap;
+  }
+  if (((slots == NULL) || ((unsigned int)atomsUsed + 1 > (mask + 1) / 8 * MAXLOAD)) &&
+      !growTable())
+  {
+    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    return 0;
+  }
+  name = (char *)arenaAlloc(len + 1);
+  if (name == NULL)
+  {
+    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    return 0;
+  }
+  memcpy(name, s, len);
+  name[len] = '\0';
+  atomNames[atomsUsed] = name;
+  atomLens[atomsUsed] = len;
+  placeSlot(h, atomsUsed);
+  return atomsUsed++;
+} /* internName */
+
+/* Function findName returns the atom of the
+ * identifier s, or -1 if it was never interned
+ */
+int findName(const char *s)
+{
+  int len = (int)strlen(s);
+  return lookup(s, len, hash(s, len));
+}
+
+/* Function atomName returns the identifier
+ * text of an atom
+ */
+char *atomName(int atom)
+{
+  return atomNames[atom];
+}
+
+/* Function atomCount returns the number of
+ * distinct identifiers interned so far
+ */
+int atomCount(void)
+{
+  return atomsUsed;
+}
+
+/* Procedure freeNames forgets all atoms; the
+ * names themselves belong to the arena
+ */
+void freeNames(void)
+{
+  free(slots);
+  slots = NULL;
+  mask = 0;
+  free(atomNames);
+  free(atomLens);
+  atomNames = NULL;
+  atomLens = NULL;
+  atomsUsed = atomsCapacity = 0;
+}
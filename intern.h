@@ -0,0 +1,38 @@
+/****************************************************/
+/* File: intern.h                                   */
+/* Identifier interning for the TINY compiler:      */
+/* maps each distinct identifier to a dense         */
+/* integer atom (0, 1, 2, ...)                      */
+/****************************************************/
+
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+/* Function internName returns the atom of the
+ * identifier s of length len (s need not be
+ * '\0'-terminated), adding it if it is new
+ */
+int internName(const char *s, int len);
+
+/* Function findName returns the atom of the
+ * '\0'-terminated identifier s, or -1 if it
+ * was never interned
+ */
+int findName(const char *s);
+
+/* Function atomName returns the identifier
+ * text of an atom
+ */
+char *atomName(int atom);
+
+/* Function atomCount returns the number of
+ * distinct identifiers interned so far
+ */
+int atomCount(void);
+
+/* Procedure freeNames forgets all atoms; it
+ * must be called before arenaFree
+ */
+void freeNames(void);
+
+#endif
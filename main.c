@@ -18,14 +18,20 @@
 #define NO_CODE FALSE
 
 #include "util.h"
-#if NO_PARSE
+#include "intern.h"
+#include "arena.h"
+#include "symtab.h"
+#include "stats.h"
 #include "scan.h"
-#else
+#if !NO_PARSE
 #include "parse.h"
 #if !NO_ANALYZE
+#include "flat.h"
 #include "analyze.h"
+#include "optimize.h"
 #if !NO_CODE
 #include "cgen.h"
+#include "code.h"
 #endif
 #endif
 #endif
@@ -43,19 +49,107 @@ int TraceParse = TRUE;
 int TraceAnalyze = TRUE;
 int TraceCode = TRUE;
 
+/* allocate and set scanner and tree modes */
+int PreTokenize = FALSE;
+int FlatAST = FALSE;
+int CrossRef = FALSE;
+
+/* allocate and set optimization level */
+int OptLevel = 0;
+
 int Error = FALSE;
 
+/* LISTBUFSIZE is the size of the user-space buffer
+ * through which all listing and code output goes
+ */
+#define LISTBUFSIZE (4 * 1024 * 1024)
+
+static void usage(char *prog)
+{
+    fprintf(stderr, "usage: %s [options] <filename>\n", prog);
+    fprintf(stderr, "options:\n"
+                    "  -echo, -no-echo        echo source lines in the listing\n"
+                    "  -scan, -no-scan        trace tokens\n"
+                    "  -parse, -no-parse      print the syntax tree\n"
+                    "  -analyze, -no-analyze  trace symbol table and type checking\n"
+                    "  -code, -no-code        comment the generated code\n"
+                    "  -quiet                 turn every trace off\n"
+                    "  -tokens                scan the whole file before parsing\n"
+                    "  -flat                  analyze the flat form of the syntax tree\n"
+                    "  -xref                  list the lines where each variable is used\n"
+                    "  -O, -O<n>              optimize (level n, 0 = off, -O = -O1)\n"
+                    "  -o <file>              write the TM code to file\n"
+                    "  -tmb                   write the TM code as a binary object (.tmb)\n"
+                    "  -time-report[=json]    report time and memory per phase on stderr\n");
+    exit(1);
+}
+
+/* Function setFlag recognizes the switch arg (with
+ * or without the "no-" prefix) for one flag
+ */
+static int setFlag(char *arg, char *name, int *flag)
+{
+    if (strcmp(arg + 1, name) == 0)
+        *flag = TRUE;
+    else if ((strncmp(arg + 1, "no-", 3) == 0) && (strcmp(arg + 4, name) == 0))
+        *flag = FALSE;
+    else
+        return FALSE;
+    return TRUE;
+}
+
 int main(int argc, char *argv[])
 {
 
     TreeNode *syntaxTree;
-    char pgm[120]; /* source code file name */
-    if (argc != 2)
+    char *pgm = NULL;      /* source code file name */
+    char *codefile = NULL; /* code file name (-o) */
+    int timeReport = 0;    /* 1 = text report, 2 = JSON report */
+    int binary = FALSE;    /* write a .tmb object */
+    int i;
+    for (i = 1; i < argc; i++)
     {
-        fprintf(stderr, "usage: %s <filename>\n", argv[0]);
-        exit(1);
+        char *arg = argv[i];
+        if (arg[0] != '-')
+        {
+            if (pgm != NULL)
+                usage(argv[0]);
+            pgm = (char *)malloc(strlen(arg) + 5);
+            strcpy(pgm, arg);
+        }
+        else if (strcmp(arg, "-o") == 0)
+        {
+            if (++i == argc)
+                usage(argv[0]);
+            codefile = argv[i];
+        }
+        else if ((arg[1] == 'O') && ((arg[2] == '\0') || isdigit((unsigned char)arg[2])))
+            OptLevel = (arg[2] == '\0') ? 1 : atoi(arg + 2);
+        else if (strcmp(arg, "-time-report") == 0)
+            timeReport = 1;
+        else if (strcmp(arg, "-time-report=json") == 0)
+            timeReport = 2;
+        else if (strcmp(arg, "-quiet") == 0)
+            EchoSource = TraceScan = TraceParse = TraceAnalyze = TraceCode = FALSE;
+        else if (strcmp(arg, "-tokens") == 0)
+            PreTokenize = TRUE;
+        else if (strcmp(arg, "-flat") == 0)
+            FlatAST = TRUE;
+        else if (strcmp(arg, "-xref") == 0)
+            CrossRef = TRUE;
+        else if (strcmp(arg, "-tmb") == 0)
+            binary = TRUE;
+        else if (!setFlag(arg, "echo", &EchoSource) &&
+                 !setFlag(arg, "scan", &TraceScan) &&
+                 !setFlag(arg, "parse", &TraceParse) &&
+                 !setFlag(arg, "analyze", &TraceAnalyze) &&
+                 !setFlag(arg, "code", &TraceCode))
+            usage(argv[0]);
     }
-    strcpy(pgm, argv[1]);
+    if (pgm == NULL)
+        usage(argv[0]);
+    if (TraceAnalyze) /* the symbol table listing shows the lines */
+        CrossRef = TRUE;
     if (strchr(pgm, '.') == NULL)
         strcat(pgm, ".tny");
     source = fopen(pgm, "r");
@@ -66,12 +160,22 @@ int main(int argc, char *argv[])
     }
 
     listing = stdout; /* send listing to screen */
+    /* listing is fully buffered: it is only written out when the
+       buffer fills or at exit */
+    setvbuf(listing, NULL, _IOFBF, LISTBUFSIZE);
     fprintf(listing, "\nTINY COMPILATION: %s\n", pgm);
 #if NO_PARSE // se for setada como verdadeira a análise sintática não é realizada somente a lexica 
     while (getToken() != ENDFILE)
         ;
 #else
+    if (PreTokenize)
+    { /* scanning is a phase of its own */
+        phaseBegin(PhScan);
+        phaseEnd(PhScan, scanTokens());
+    }
+    phaseBegin(PhParse);
     syntaxTree = parse();
+    phaseEnd(PhParse, treeNodeCount());
     if (TraceParse)
     {
         fprintf(listing, "\nSyntax tree:\n");
@@ -82,33 +186,80 @@ int main(int argc, char *argv[])
     {
         if (TraceAnalyze)
             fprintf(listing, "\nBuilding Symbol Table...\n");
-        buildSymtab(syntaxTree); // essa função constroi a tabela de simbolos para a árvore sintática que recebeu como argumento
-        if (TraceAnalyze)
-            fprintf(listing, "\nChecking Types...\n");
-        typeCheck(syntaxTree); // faz a verificação de tipos para a árvore sintática
+        if (FlatAST)
+        { // a análise é feita sobre a árvore plana, por uma varredura linear
+            FlatTree *flatTree;
+            phaseBegin(PhAnalyze);
+            flatTree = flattenTree(syntaxTree);
+            printFlatStats(flatTree);
+            analyzeFlat(flatTree);
+            phaseEnd(PhAnalyze, flatTree->count);
+            freeFlatTree(flatTree);
+        }
+        else
+        {
+            phaseBegin(PhAnalyze);
+            analyze(syntaxTree); // constroi a tabela de simbolos e verifica os tipos numa única travessia da árvore sintática
+            phaseEnd(PhAnalyze, treeNodeCount());
+        }
         if (TraceAnalyze)
             fprintf(listing, "\nType Checking Finished\n");
+        else if (CrossRef)
+        {
+            fprintf(listing, "\nCross Reference:\n\n");
+            printSymTab(listing);
+        }
+    }
+    if (!Error && (OptLevel > 0))
+    { // simplifica a árvore sintática antes da geração de código
+        phaseBegin(PhOptimize);
+        syntaxTree = optimize(syntaxTree);
+        phaseEnd(PhOptimize, eliminatedNodeCount());
     }
 #if !NO_CODE // se for verdadeiro e não houver nenhuma condição de erro em relação a semântica então gera código
     if (!Error)
     {
-        char *codefile;
-        int fnlen = strcspn(pgm, ".");
-        codefile = (char *)calloc(fnlen + 4, sizeof(char));
-        strncpy(codefile, pgm, fnlen);
-        strcat(codefile, ".tm");
-        code = fopen(codefile, "w");
+        if (codefile == NULL)
+        { /* default: source file name with extension .tm (.tmb) */
+            int fnlen = strcspn(pgm, ".");
+            codefile = (char *)calloc(fnlen + 5, sizeof(char));
+            strncpy(codefile, pgm, fnlen);
+            strcat(codefile, binary ? ".tmb" : ".tm");
+        }
+        code = fopen(codefile, binary ? "wb" : "w");
         if (code == NULL)
         {
             printf("Unable to open %s\n", codefile);
             exit(1);
         }
+        setvbuf(code, NULL, _IOFBF, LISTBUFSIZE);
+        phaseBegin(PhCodeGen);
         codeGen(syntaxTree, codefile); // recebe a árvore sintática e o árquivo que vai conter o código gerado
+        phaseEnd(PhCodeGen, emitCount());
+        if (OptLevel > 0)
+        {
+            phaseBegin(PhPeephole);
+            phaseEnd(PhPeephole, peephole());
+        }
+        phaseBegin(PhEmit);
+        if (binary)
+            writeObject();
+        else
+            writeCode();
         fclose(code);
+        phaseEnd(PhEmit, emitCount());
     }
 #endif
 #endif
 #endif
+    if (timeReport)
+        printTimeReport(stderr, pgm, timeReport == 2);
+    /* tree, names and symbols of this compilation are released at once */
+    releaseSource();
+    freeSymTab();
+    freeNames();
+    arenaFree();
     fclose(source);
+    fflush(listing);
     return 0;
 }
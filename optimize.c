@@ -0,0 +1,271 @@
+/****************************************************/
+/* File: optimize.c                                 */
+/* Syntax tree optimizer implementation             */
+/* for the TINY compiler                            */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "util.h"
+#include "optimize.h"
+
+/* number of nodes removed from the tree */
+static long eliminated = 0;
+
+/* nodes counted by countNode */
+static long counted;
+
+static void countNode(TreeNode *t)
+{
+  counted++;
+}
+
+static void nullProc(TreeNode *t)
+{
+}
+
+/* Function subtreeSize returns the number of
+ * nodes of the expression t
+ */
+static long subtreeSize(TreeNode *t)
+{
+  if ((t->child[0] == NULL) && (t->child[1] == NULL) &&
+      (t->child[2] == NULL) && (t->sibling == NULL))
+    return 1;
+  counted = 0;
+  traverseTree(t, countNode, nullProc);
+  return counted;
+}
+
+/* set by checkTrap when a division may fail */
+static int trap;
+
+static void checkTrap(TreeNode *t)
+{
+  if ((t->nodekind == ExpK) && (t->kind.exp == OpK) && (t->attr.op == OVER) &&
+      ((t->child[1] == NULL) || (t->child[1]->kind.exp != ConstK) ||
+       (t->child[1]->attr.val == 0)))
+    trap = TRUE;
+}
+
+/* Function mayTrap tells whether evaluating the
+ * expression t may stop the TM with a division
+ * by zero; such an expression cannot be dropped
+ */
+static int mayTrap(TreeNode *t)
+{
+  trap = FALSE;
+  traverseTree(t, checkTrap, nullProc);
+  return trap;
+}
+
+/* TRUE if t is the constant n */
+static int isConst(TreeNode *t, int n)
+{
+  return (t != NULL) && (t->nodekind == ExpK) &&
+         (t->kind.exp == ConstK) && (t->attr.val == n);
+}
+
+/* Procedure replaceBy makes t a copy of its
+ * operand keep (keeping its place in the tree)
+ * and drops the other operand
+ */
+static void replaceBy(TreeNode *t, TreeNode *keep, TreeNode *drop)
+{
+  TreeNode *sibling = t->sibling;
+  eliminated += 1 + subtreeSize(drop);
+  *t = *keep;
+  t->sibling = sibling;
+}
+
+/* Procedure makeConst turns the operation t into
+ * the constant val, dropping its operands
+ */
+static void makeConst(TreeNode *t, int val)
+{
+  int i;
+  for (i = 0; i < MAXCHILDREN; i++)
+    if (t->child[i] != NULL)
+    {
+      eliminated += subtreeSize(t->child[i]);
+      t->child[i] = NULL;
+    }
+  t->kind.exp = ConstK;
+  t->attr.val = val;
+}
+
+/* Procedure foldNode simplifies an operation
+ * whose operands are already simplified. The
+ * arithmetic wraps around like the TM's, and
+ * < and = are computed from the difference of
+ * the operands, as in the generated code
+ */
+static void foldNode(TreeNode *t)
+{
+  TreeNode *a, *b;
+  if ((t->nodekind != ExpK) || (t->kind.exp != OpK))
+    return;
+  a = t->child[0];
+  b = t->child[1];
+  if ((a == NULL) || (b == NULL))
+    return;
+  if ((t->attr.op == OVER) && isConst(b, 0))
+  {
+    fprintf(listing, "Warning at line %d: division by zero\n", t->lineno);
+    return;
+  }
+  if ((a->kind.exp == ConstK) && (b->kind.exp == ConstK))
+  {
+    unsigned int x = (unsigned int)a->attr.val;
+    unsigned int y = (unsigned int)b->attr.val;
+    switch (t->attr.op)
+    {
+    case PLUS:
+      makeConst(t, (int)(x + y));
+      break;
+    case MINUS:
+      makeConst(t, (int)(x - y));
+      break;
+    case TIMES:
+      makeConst(t, (int)(x * y));
+      break;
+    case OVER:
+      if ((a->attr.val != INT_MIN) || (b->attr.val != -1))
+        makeConst(t, a->attr.val / b->attr.val);
+      break;
+    case LT:
+      makeConst(t, (int)(x - y) < 0);
+      break;
+    case EQ:
+      makeConst(t, x == y);
+      break;
+    default:
+      break;
+    }
+    return;
+  }
+  switch (t->attr.op)
+  {
+  case PLUS:
+    if (isConst(b, 0))
+      replaceBy(t, a, b);
+    else if (isConst(a, 0))
+      replaceBy(t, b, a);
+    break;
+  case MINUS:
+    if (isConst(b, 0))
+      replaceBy(t, a, b);
+    else if ((a->kind.exp == IdK) && (b->kind.exp == IdK) &&
+             (a->attr.atom == b->attr.atom))
+      makeConst(t, 0);
+    break;
+  case TIMES:
+    if ((isConst(a, 0) && !mayTrap(b)) || (isConst(b, 0) && !mayTrap(a)))
+      makeConst(t, 0);
+    else if (isConst(b, 1))
+      replaceBy(t, a, b);
+    else if (isConst(a, 1))
+      replaceBy(t, b, a);
+    break;
+  case OVER:
+    if (isConst(b, 1))
+      replaceBy(t, a, b);
+    break;
+  default:
+    break;
+  }
+}
+
+static TreeNode *optimizeStmts(TreeNode *t);
+
+/* Function optimizeStmt simplifies the statement t
+ * (detached from its siblings) and returns the
+ * statement list that replaces it
+ */
+static TreeNode *optimizeStmt(TreeNode *t)
+{
+  TreeNode *cond;
+  int i;
+  for (i = 0; i < MAXCHILDREN; i++)
+    if (t->child[i] != NULL)
+    {
+      if (t->child[i]->nodekind == ExpK)
+        traverseTree(t->child[i], nullProc, foldNode);
+      else
+        t->child[i] = optimizeStmts(t->child[i]);
+    }
+  switch (t->kind.stmt)
+  {
+  case IfK:
+    cond = t->child[0];
+    if ((cond != NULL) && (cond->kind.exp == ConstK))
+    {
+      TreeNode *taken = (cond->attr.val != 0) ? t->child[1] : t->child[2];
+      TreeNode *other = (cond->attr.val != 0) ? t->child[2] : t->child[1];
+      eliminated += 2;
+      if (other != NULL)
+        eliminated += subtreeSize(other);
+      return taken;
+    }
+    break;
+  case WhileK:
+    cond = t->child[0];
+    if ((cond != NULL) && (cond->kind.exp == ConstK) && (cond->attr.val == 0))
+    { /* the body never runs */
+      t->sibling = NULL;
+      eliminated += subtreeSize(t);
+      return NULL;
+    }
+    break;
+  case RepeatK:
+    cond = t->child[1];
+    if ((cond != NULL) && (cond->kind.exp == ConstK) && (cond->attr.val != 0))
+    { /* the body runs once */
+      eliminated += 2;
+      return t->child[0];
+    }
+    break;
+  default:
+    break;
+  }
+  return t;
+}
+
+/* Function optimizeStmts simplifies a statement
+ * list and returns its new first statement
+ */
+static TreeNode *optimizeStmts(TreeNode *t)
+{
+  TreeNode *head = NULL;
+  TreeNode **link = &head;
+  while (t != NULL)
+  {
+    TreeNode *next = t->sibling;
+    t->sibling = NULL;
+    *link = optimizeStmt(t);
+    while (*link != NULL)
+      link = &(*link)->sibling;
+    t = next;
+  }
+  return head;
+}
+
+/* Function optimize simplifies the syntax tree
+ * and returns the new tree
+ */
+TreeNode *optimize(TreeNode *syntaxTree)
+{
+  eliminated = 0;
+  syntaxTree = optimizeStmts(syntaxTree);
+  if (TraceAnalyze)
+    fprintf(listing, "\nOptimization: %ld nodes eliminated\n", eliminated);
+  return syntaxTree;
+}
+
+/* Function eliminatedNodeCount returns the
+ * number of nodes removed by optimize
+ */
+long eliminatedNodeCount(void)
+{
+  return eliminated;
+}
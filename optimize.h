@@ -0,0 +1,27 @@
+/****************************************************/
+/* File: optimize.h                                 */
+/* Syntax tree optimizer for the TINY compiler:     */
+/* constant folding and algebraic simplification,   */
+/* run between semantic analysis and code           */
+/* generation                                       */
+/****************************************************/
+
+#ifndef _OPTIMIZE_H_
+#define _OPTIMIZE_H_
+
+/* Function optimize folds constant operations,
+ * applies the identities x+0, x-0, x*1, x/1, x*0
+ * and x-x, and removes if, while and repeat
+ * statements whose test is a constant. It
+ * returns the new syntax tree (NULL if nothing
+ * is left). Divisions by a constant zero are
+ * not folded and are reported as warnings
+ */
+TreeNode *optimize(TreeNode *syntaxTree);
+
+/* Function eliminatedNodeCount returns the
+ * number of nodes removed by optimize
+ */
+long eliminatedNodeCount(void);
+
+#endif
@@ -10,6 +10,31 @@
 #include "parse.h"
 
 static TokenType token; /* holds current token */
+static int tokenIndex;  /* posição de token em tokenStream (modo PreTokenize) */
+
+/* Avança para o próximo token: chama o scanner ou, no modo PreTokenize,
+   apenas consome a próxima posição de tokenStream */
+static TokenType nextToken(void)
+{
+  if (!PreTokenize)
+    return getToken();
+  if (tokenIndex + 1 < tokenStream.count)
+    tokenIndex++;
+  lineno = tokenStream.line[tokenIndex];
+  return (TokenType)tokenStream.kind[tokenIndex];
+}
+
+/* Retorna o átomo do identificador corrente */
+static int currentAtom(void)
+{
+  return PreTokenize ? tokenStream.value[tokenIndex] : tokenAtom;
+}
+
+/* Retorna o lexema do token corrente */
+static char *currentLexeme(void)
+{
+  return PreTokenize ? tokenLexeme(tokenIndex) : tokenString;
+}
 
 // protótipo de todas as funções que compoem o analisador sintático
 // ca da função corresponte a um símbolo variável da gramática
@@ -37,11 +62,11 @@ static void syntaxError(char *message)
 static void match(TokenType expected)
 {
   if (token == expected)
-    token = getToken();
+    token = nextToken();
   else
   {
     syntaxError("Unexpected token -> ");
-    printToken(token, tokenString);
+    printToken(token, currentLexeme());
     fprintf(listing, "      ");
   }
 }
@@ -99,8 +124,8 @@ TreeNode *statement(void)
     break;
   default:
     syntaxError("Unexpected token1 -> ");
-    printToken(token, tokenString);
-    token = getToken();
+    printToken(token, currentLexeme());
+    token = nextToken();
     break;
   } /* end case */
   return t;
@@ -158,7 +183,7 @@ TreeNode *assign_stmt(void)
 {
   TreeNode *t = newStmtNode(AssignK);
   if ((t != NULL) && (token == ID))
-    t->attr.name = copyString(tokenString);
+    t->attr.atom = currentAtom();
   match(ID);
   match(ASSIGN);
   if (t != NULL)
@@ -172,7 +197,7 @@ TreeNode *read_stmt(void)
   TreeNode *t = newStmtNode(ReadK);
   match(READ);
   if ((t != NULL) && (token == ID))
-    t->attr.name = copyString(tokenString);
+    t->attr.atom = currentAtom();
   match(ID);
   return t;
 }
@@ -254,19 +279,19 @@ TreeNode *factor(void)
   case NUM:
     t = newExpNode(ConstK);
     if ((t != NULL) && (token == NUM))
-      t->attr.val = atoi(tokenString);
+      t->attr.val = PreTokenize ? tokenStream.value[tokenIndex] : atoi(tokenString);
     match(NUM);
     break;
   case ID:
     t = newExpNode(IdK);
     if ((t != NULL) && (token == ID))
-      t->attr.name = copyString(tokenString);
+      t->attr.atom = currentAtom();
     match(ID);
     break;
   default:
     syntaxError("unexpected token -> ");
-    printToken(token, tokenString);
-    token = getToken();
+    printToken(token, currentLexeme());
+    token = nextToken();
     break;
   }
   return t;
@@ -280,9 +305,20 @@ TreeNode *factor(void)
 TreeNode *parse(void)
 {
   TreeNode *t;
-  token = getToken(); // reconhecimento de token
+  if (PreTokenize)
+  { // o arquivo inteiro é escaneado antes da análise sintática
+    if (tokenStream.count == 0)
+      scanTokens();
+    tokenIndex = 0;
+    lineno = tokenStream.line[0];
+    token = (TokenType)tokenStream.kind[0];
+  }
+  else
+    token = nextToken(); // reconhecimento de token
   t = stmt_sequence(); // iniciar o reconhecimento sintático
   if (token != ENDFILE)
     syntaxError("Code ends before file\n"); // retorna o ponteiro para a árvore sintática
+  if (PreTokenize)
+    freeTokens();
   return t;
 }
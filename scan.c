@@ -8,6 +8,7 @@
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
+#include "intern.h"
 
 /* Corresponde aos estados do AFD da linguagem */
 typedef enum
@@ -23,189 +24,385 @@ typedef enum
 /* vetor de char para armazenamento do lexema do token corrente */
 char tokenString[MAXTOKENLEN + 1];
 
-/* Tamanho do vetor para armazenamento linha a linha do código fonte */
-#define BUFLEN 256
+/* átomo do último identificador reconhecido */
+int tokenAtom = -1;
 
-static char lineBuf[BUFLEN]; /* vetor para armazenamento linha a linha do código fonte */
-static int linepos = 0;      /* guarda a posição corrente de leitura em linebuf */
-static int bufsize = 0;      /* tamanho da string corrente em linebuf em determinado momento */
-static int EOF_flag = FALSE; /* corrects ungetNextChar behavior on EOF */
+/* O arquivo fonte inteiro é mantido em memória: mapeado com mmap quando
+   o sistema permite, ou lido em blocos grandes caso contrário. O scanner
+   percorre esse buffer diretamente, sem copiar linha a linha */
+#if defined(_WIN32)
+#define USE_MMAP FALSE
+#else
+#define USE_MMAP TRUE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
-/* Função chamada para retornar o proximo caracter a partir de linebuf */
-static int getNextChar(void)
+/* Tamanho dos blocos de leitura quando o arquivo não pode ser mapeado */
+#define READBLOCK (1 << 20)
+
+static char *srcBuf = NULL;    /* texto completo do código fonte */
+static long srcLen = 0;        /* tamanho do código fonte em bytes */
+static long srcPos = 0;        /* guarda a posição corrente de leitura em srcBuf */
+static long lineEnd = 0;       /* fim da linha corrente (logo após o '\n') */
+static int srcLoaded = FALSE;  /* indica se o fonte já foi carregado */
+static int srcMapped = FALSE;  /* indica se srcBuf veio de mmap */
+static int EOF_flag = FALSE;   /* corrects ungetNextChar behavior on EOF */
+static long lexStart = 0;      /* início em srcBuf do último lexema reconhecido */
+static long lexEnd = 0;        /* fim em srcBuf do último lexema reconhecido */
+
+/* Carrega o arquivo source inteiro em srcBuf */
+static void loadSource(void)
 {
-  if (!(linepos < bufsize))
+  long cap;
+  size_t n;
+  srcLoaded = TRUE;
+#if USE_MMAP
   {
-    lineno++;
-    if (fgets(lineBuf, BUFLEN - 1, source))
+    struct stat st;
+    int fd = fileno(source);
+    if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0))
     {
-      if (EchoSource)
-        fprintf(listing, "%4d: %s", lineno, lineBuf);
-      bufsize = strlen(lineBuf);
-      linepos = 0;
-      return lineBuf[linepos++];
+      void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED)
+      {
+        madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+        srcBuf = (char *)p;
+        srcLen = (long)st.st_size;
+        srcMapped = TRUE;
+        return;
+      }
     }
-    else
+  }
+#endif
+  /* não foi possível mapear (pipe, Windows...): lê em blocos grandes */
+  cap = READBLOCK;
+  srcBuf = (char *)malloc(cap);
+  while ((srcBuf != NULL) &&
+         ((n = fread(srcBuf + srcLen, 1, cap - srcLen, source)) > 0))
+  {
+    srcLen += (long)n;
+    if (srcLen == cap)
     {
-      EOF_flag = TRUE;
-      return EOF;
+      char *p = (char *)realloc(srcBuf, cap * 2);
+      if (p == NULL)
+      {
+        free(srcBuf);
+        srcBuf = NULL;
+        break;
+      }
+      srcBuf = p;
+      cap *= 2;
     }
   }
-  else
-    return lineBuf[linepos++];
+  if (srcBuf == NULL)
+  {
+    fprintf(listing, "Out of memory error reading source\n");
+    srcLen = 0;
+  }
+}
+
+/* Avança para a próxima linha do buffer, ecoando-a no listing
+   se EchoSource estiver ativo. Retorna FALSE no fim do arquivo */
+static int nextLine(void)
+{
+  char *nl;
+  lineno++;
+  if (!srcLoaded)
+    loadSource();
+  if (!(srcPos < srcLen))
+  {
+    EOF_flag = TRUE;
+    return FALSE;
+  }
+  nl = (char *)memchr(srcBuf + srcPos, '\n', srcLen - srcPos);
+  lineEnd = (nl == NULL) ? srcLen : (long)(nl - srcBuf) + 1;
+  if (EchoSource)
+  {
+    fprintf(listing, "%4d: ", lineno);
+    fwrite(srcBuf + srcPos, 1, lineEnd - srcPos, listing);
+  }
+  return TRUE;
+}
+
+/* Função chamada para retornar o proximo caracter do buffer */
+static int getNextChar(void)
+{
+  if (!(srcPos < lineEnd) && !nextLine())
+    return EOF;
+  return (unsigned char)srcBuf[srcPos++];
 }
 
 /*Retrocede uma posição no buffer */
 static void ungetNextChar(void)
 {
   if (!EOF_flag)
-    linepos--;
+    srcPos--;
 }
 
-/* Tabela de palavras reservadas contém todas as palavras reservadas com seu correspondente lexema */
-static struct
+/* Libera o buffer do código fonte e reinicia o estado do scanner */
+void releaseSource(void)
 {
-  char *str;
-  TokenType tok;
-} reservedWords[MAXRESERVED] = {{"if", IF}, {"then", THEN}, {"else", ELSE}, {"endif", ENDIF}, {"repeat", REPEAT}, {"until", UNTIL}, {"read", READ}, {"write", WRITE}, {"while", WHILE}, {"endwhile", ENDWHILE}};
+  if (srcBuf != NULL)
+  {
+#if USE_MMAP
+    if (srcMapped)
+      munmap(srcBuf, (size_t)srcLen);
+    else
+#endif
+      free(srcBuf);
+  }
+  srcBuf = NULL;
+  srcLen = srcPos = lineEnd = 0;
+  srcLoaded = srcMapped = EOF_flag = FALSE;
+}
+
+/* Hash perfeito das palavras reservadas: combina o tamanho do lexema com
+   a primeira, a segunda e a última letra. Os valores são constantes em
+   tempo de compilação, então uma colisão ao acrescentar uma palavra em
+   RESERVED_WORDS aparece como "duplicate case value" em reservedLookup;
+   letras que não correspondem ao lexema são apontadas por checkReserved */
+#define KWHASH(len, c0, c1, cn) (((len) + (c0) + (c1) + (cn)) & 31)
+
+#define RESERVED_CASE(tok, str, c0, c1, cn)                             \
+  case KWHASH(sizeof(str) - 1, c0, c1, cn):                             \
+    if ((len == sizeof(str) - 1) && (memcmp(s, str, sizeof(str) - 1) == 0)) \
+      return tok;                                                       \
+    break;
+
+/* As letras de cada entrada de RESERVED_WORDS, conferidas com o lexema
+   uma única vez por initCharClass: uma letra errada faria a palavra cair
+   em outro case e ser reconhecida como ID, sem nenhum aviso */
+typedef struct
+{
+  const char *str;
+  char c0, c1, cn;
+} ReservedLetters;
+
+#define RESERVED_LETTERS(tok, str, c0, c1, cn) {str, c0, c1, cn},
+
+static const ReservedLetters reservedLetters[] = {
+    RESERVED_WORDS(RESERVED_LETTERS)};
 
-/*Recebe uma string e verifica se a string é uma palavra reservada*/
-/* faz isso usando busca linear*/
-static TokenType reservedLookup(char *s)
+static void checkReserved(void)
 {
   int i;
   for (i = 0; i < MAXRESERVED; i++)
-    if (!strcmp(s, reservedWords[i].str))
-      return reservedWords[i].tok;
+  {
+    const ReservedLetters *r = &reservedLetters[i];
+    int len = (int)strlen(r->str);
+    if ((r->c0 != r->str[0]) || (r->c1 != r->str[1]) || (r->cn != r->str[len - 1]))
+    {
+      fprintf(stderr, "Internal error: wrong hash letters for reserved word %s\n",
+              r->str);
+      exit(1);
+    }
+  }
+}
+
+/*Recebe o lexema s de tamanho len (terminado em '\0') e verifica se
+  é uma palavra reservada: um hash e no máximo uma comparação */
+static TokenType reservedLookup(const char *s, int len)
+{
+  switch (KWHASH(len, (unsigned char)s[0], (unsigned char)s[1],
+                 (unsigned char)s[len - 1]))
+  {
+    RESERVED_WORDS(RESERVED_CASE)
+  default:
+    break;
+  }
   return ID; // caso não seja retorna como sendo um identificador
 }
 
+/* Classes de caracteres usadas para indexar a tabela de transição do AFD */
+typedef enum
+{
+  C_OTHER,
+  C_EOF,
+  C_DIGIT,
+  C_LETTER, /* letras e '_' */
+  C_SPACE,
+  C_LBRACE,
+  C_RBRACE,
+  C_COLON,
+  C_EQ,
+  C_LT,
+  C_PLUS,
+  C_MINUS,
+  C_TIMES,
+  C_OVER,
+  C_SEMI,
+  NUMCLASSES
+} CharClass;
+
+/* Tabela de classes dos 256 valores de byte, independente de locale;
+   preenchida uma única vez por initCharClass */
+static unsigned char charClass[256];
+static int charClassReady = FALSE;
+
+static void initCharClass(void)
+{
+  int c;
+  for (c = 0; c < 256; c++)
+    charClass[c] = C_OTHER;
+  for (c = '0'; c <= '9'; c++)
+    charClass[c] = C_DIGIT;
+  for (c = 'a'; c <= 'z'; c++)
+    charClass[c] = C_LETTER;
+  for (c = 'A'; c <= 'Z'; c++)
+    charClass[c] = C_LETTER;
+  charClass['_'] = C_LETTER;
+  charClass[' '] = charClass['\t'] = charClass['\n'] = C_SPACE;
+  charClass['{'] = C_LBRACE;
+  charClass['}'] = C_RBRACE;
+  charClass[':'] = C_COLON;
+  charClass['='] = C_EQ;
+  charClass['<'] = C_LT;
+  charClass['+'] = C_PLUS;
+  charClass['-'] = C_MINUS;
+  charClass['*'] = C_TIMES;
+  charClass['/'] = C_OVER;
+  charClass[';'] = C_SEMI;
+  checkReserved();
+  charClassReady = TRUE;
+}
+
+/* ações associadas a uma transição */
+#define A_SAVE 1  /* o caracter faz parte do lexema */
+#define A_UNGET 2 /* retrocede no buffer (lookahead) */
+
+/* Entrada da tabela de transição: próximo estado, ações e,
+   quando o próximo estado é DONE, o token reconhecido */
+typedef struct
+{
+  unsigned char next;
+  unsigned char action;
+  unsigned char token;
+} Transition;
+
+/* Tabela de transição do AFD indexada por (estado, classe do caracter);
+   as linhas seguem a ordem de StateType, sem a linha de DONE */
+static const Transition transTable[DONE][NUMCLASSES] = {
+    /* START */
+    {{DONE, A_SAVE, ERROR}, {DONE, 0, ENDFILE}, {INNUM, A_SAVE, ERROR},
+     {INID, A_SAVE, ERROR}, {START, 0, ERROR}, {INCOMMENT, 0, ERROR},
+     {DONE, A_SAVE, ERROR}, {INASSIGN, A_SAVE, ERROR}, {DONE, A_SAVE, EQ},
+     {DONE, A_SAVE, LT}, {DONE, A_SAVE, PLUS}, {DONE, A_SAVE, MINUS},
+     {DONE, A_SAVE, TIMES}, {DONE, A_SAVE, OVER}, {DONE, A_SAVE, SEMI}},
+    /* INASSIGN */
+    {{DONE, A_UNGET, DDOT}, {DONE, A_UNGET, DDOT}, {DONE, A_UNGET, DDOT},
+     {DONE, A_UNGET, DDOT}, {DONE, A_UNGET, DDOT}, {DONE, A_UNGET, DDOT},
+     {DONE, A_UNGET, DDOT}, {DONE, A_UNGET, DDOT}, {DONE, A_SAVE, ASSIGN},
+     {DONE, A_UNGET, DDOT}, {DONE, A_UNGET, DDOT}, {DONE, A_UNGET, DDOT},
+     {DONE, A_UNGET, DDOT}, {DONE, A_UNGET, DDOT}, {DONE, A_UNGET, DDOT}},
+    /* INCOMMENT */
+    {{INCOMMENT, 0, ERROR}, {DONE, 0, ENDFILE}, {INCOMMENT, 0, ERROR},
+     {INCOMMENT, 0, ERROR}, {INCOMMENT, 0, ERROR}, {INCOMMENT, 0, ERROR},
+     {START, 0, ERROR}, {INCOMMENT, 0, ERROR}, {INCOMMENT, 0, ERROR},
+     {INCOMMENT, 0, ERROR}, {INCOMMENT, 0, ERROR}, {INCOMMENT, 0, ERROR},
+     {INCOMMENT, 0, ERROR}, {INCOMMENT, 0, ERROR}, {INCOMMENT, 0, ERROR}},
+    /* INNUM */
+    {{DONE, A_UNGET, NUM}, {DONE, A_UNGET, NUM}, {INNUM, A_SAVE, ERROR},
+     {DONE, A_UNGET, NUM}, {DONE, A_UNGET, NUM}, {DONE, A_UNGET, NUM},
+     {DONE, A_UNGET, NUM}, {DONE, A_UNGET, NUM}, {DONE, A_UNGET, NUM},
+     {DONE, A_UNGET, NUM}, {DONE, A_UNGET, NUM}, {DONE, A_UNGET, NUM},
+     {DONE, A_UNGET, NUM}, {DONE, A_UNGET, NUM}, {DONE, A_UNGET, NUM}},
+    /* INID */
+    {{DONE, A_UNGET, ID}, {DONE, A_UNGET, ID}, {INID, A_SAVE, ERROR},
+     {INID, A_SAVE, ERROR}, {DONE, A_UNGET, ID}, {DONE, A_UNGET, ID},
+     {DONE, A_UNGET, ID}, {DONE, A_UNGET, ID}, {DONE, A_UNGET, ID},
+     {DONE, A_UNGET, ID}, {DONE, A_UNGET, ID}, {DONE, A_UNGET, ID},
+     {DONE, A_UNGET, ID}, {DONE, A_UNGET, ID}, {DONE, A_UNGET, ID}}};
+
+/* Consome diretamente do buffer, até o fim da linha corrente, a sequência
+   de caracteres que mantém o AFD em state (corpo de identificadores,
+   números, comentários e espaços), sem passar caracter a caracter pela
+   tabela de transição. Retorna o novo tamanho do lexema */
+static int consumeRun(StateType state, int tokenStringIndex)
+{
+  long p = srcPos;
+  long n;
+  switch (state)
+  {
+  case INID:
+    while (p < lineEnd)
+    {
+      int cls = charClass[(unsigned char)srcBuf[p]];
+      if ((cls != C_LETTER) && (cls != C_DIGIT))
+        break;
+      p++;
+    }
+    break;
+  case INNUM:
+    while ((p < lineEnd) && (charClass[(unsigned char)srcBuf[p]] == C_DIGIT))
+      p++;
+    break;
+  case INCOMMENT:
+  {
+    char *rb = (char *)memchr(srcBuf + p, '}', lineEnd - p);
+    p = (rb == NULL) ? lineEnd : (long)(rb - srcBuf);
+    srcPos = p;
+    return tokenStringIndex;
+  }
+  case START:
+    while ((p < lineEnd) && (charClass[(unsigned char)srcBuf[p]] == C_SPACE))
+      p++;
+    srcPos = p;
+    return tokenStringIndex;
+  default:
+    return tokenStringIndex;
+  }
+  n = p - srcPos;
+  if (n > MAXTOKENLEN - tokenStringIndex)
+    n = MAXTOKENLEN - tokenStringIndex;
+  memcpy(tokenString + tokenStringIndex, srcBuf + srcPos, n);
+  srcPos = p;
+  return tokenStringIndex + (int)n;
+}
+
 /****************************************/
 /* the primary function of the scanner  */
 /****************************************/
-/* corresponde a implementação do AFD
+/* corresponde a implementação do AFD, dirigida pela tabela transTable
  */
 
 TokenType getToken(void)
 { // armazena o token corrente 
   int tokenStringIndex = 0;
   /* holds current token to be returned */
-  TokenType currentToken;
+  TokenType currentToken = ERROR;
   // armazena o estado corrente do AFD 
   StateType state = START;
- //indica se um caracter que está sendo lido deva ou não compor o lexema
-  int save;
+  const Transition *tr;
+  if (!charClassReady)
+    initCharClass();
   while (state != DONE)
   {
     int c = getNextChar(); // pega o caracter
-    save = TRUE; // seta como true para entrar no switch
-    switch (state)
-    {
-    case START: // corresponde ao primeiro estado do automato
-      if (isdigit(c)) // se for um digito
-        state = INNUM;
-      else if (isalpha(c) || c == '_')
-        state = INID;
-      else if (c == ':')
-        state = INASSIGN;
-      else if ((c == ' ') || (c == '\t') || (c == '\n'))
-        save = FALSE;
-      else if (c == '{')
-      {
-        save = FALSE;
-        state = INCOMMENT;
-      }
-      else
-      {
-        state = DONE;
-        switch (c)
-        {
-        case EOF:
-          save = FALSE;
-          currentToken = ENDFILE;
-          break;
-        case '=':
-          currentToken = EQ;
-          break;
-        case '<':
-          currentToken = LT;
-          break;
-        case '+':
-          currentToken = PLUS;
-          break;
-        case '-':
-          currentToken = MINUS;
-          break;
-        case '*':
-          currentToken = TIMES;
-          break;
-        case '/':
-          currentToken = OVER;
-          break;
-        case ';':
-          currentToken = SEMI;
-          break;
-        default:
-          currentToken = ERROR;
-          break;
-        }
-      }
-      break;
-    case INCOMMENT: // reconhecimento de comentario
-      save = FALSE;
-      if (c == EOF)
-      {
-        state = DONE;
-        currentToken = ENDFILE;
-      }
-      else if (c == '}')
-        state = START;
-      break;
-    case INASSIGN:
-      state = DONE;
-      if (c == '=')
-        currentToken = ASSIGN;
-      else
-      { /* backup in the input */
-        ungetNextChar();
-        save = FALSE;
-        currentToken = DDOT;
-      }
-      break;
-    case INNUM: // reconhecimento de digito
-      if (!isdigit(c))
-      { /* backup in the input */
-        ungetNextChar();
-        save = FALSE;
-        state = DONE;
-        currentToken = NUM;
-      }
-      break;
-    case INID: // aceitação de identificadores
-      if (!isalpha(c) && !isdigit(c) && c != '_')
-      { /* backup in the input */
-        ungetNextChar();
-        save = FALSE;
-        state = DONE;
-        currentToken = ID;
-      }
-      break;
-    case DONE:
-    default: /* should never happen */
-      fprintf(listing, "Scanner Bug: state= %d\n", state);
-      state = DONE;
-      currentToken = ERROR;
-      break;
-    }
-
-    if ((save) && (tokenStringIndex <= MAXTOKENLEN)) // se save for true e a posição no vetor do token for menor que MAXTOKENLEN
-      tokenString[tokenStringIndex++] = (char)c; // acrescenta ao letor do lexema
-    if (state == DONE) // se for o estado final
-    {
-      tokenString[tokenStringIndex] = '\0';
-      if (currentToken == ID) // se for um identificador
-        currentToken = reservedLookup(tokenString); // chama essa função para verificar se é uma palavra reservada ou um ID
-    }
+    if (state == START)
+      lexStart = srcPos - 1;
+    tr = &transTable[state][(c == EOF) ? C_EOF : charClass[c]];
+    if (tr->action & A_UNGET) /* backup in the input */
+      ungetNextChar();
+    else if ((tr->action & A_SAVE) && (tokenStringIndex < MAXTOKENLEN))
+      tokenString[tokenStringIndex++] = (char)c; // acrescenta ao vetor do lexema
+    state = (StateType)tr->next;
+    if (state == DONE)
+      currentToken = (TokenType)tr->token;
+    else
+      tokenStringIndex = consumeRun(state, tokenStringIndex);
+  }
+  lexEnd = srcPos;
+  if (currentToken == ENDFILE)
+    lexStart = lexEnd;
+  tokenString[tokenStringIndex] = '\0';
+  if (currentToken == ID) // se for um identificador
+  {
+    currentToken = reservedLookup(tokenString, tokenStringIndex); // verifica se é uma palavra reservada ou um ID
+    if (currentToken == ID) // o nome completo (não truncado) é internado uma única vez aqui
+      tokenAtom = internName(srcBuf + lexStart, (int)(lexEnd - lexStart));
   }
   if (TraceScan) // se estiver setada como true é impresso o token e seu tipo
   {
@@ -214,3 +411,114 @@ TokenType getToken(void)
   }
   return currentToken; // retorna o token corrente (reconhecido)
 } /* end getToken */
+
+/****************************************/
+/* fluxo de tokens pré-escaneado        */
+/****************************************/
+
+TokenStream tokenStream;
+
+/* Garante espaço para mais um token em tokenStream; sem memória a
+   compilação termina, pois o fluxo precisa acabar em ENDFILE */
+static void growTokens(void)
+{
+  TokenStream *ts = &tokenStream;
+  int cap = (ts->capacity == 0) ? (int)(srcLen / 4) + 64 : ts->capacity * 2;
+  unsigned char *kind = (unsigned char *)realloc(ts->kind, cap);
+  int *offset = (int *)realloc(ts->offset, cap * sizeof(int));
+  int *line = (int *)realloc(ts->line, cap * sizeof(int));
+  int *value = (int *)realloc(ts->value, cap * sizeof(int));
+  if (kind != NULL)
+    ts->kind = kind;
+  if (offset != NULL)
+    ts->offset = offset;
+  if (line != NULL)
+    ts->line = line;
+  if (value != NULL)
+    ts->value = value;
+  if ((kind == NULL) || (offset == NULL) || (line == NULL) || (value == NULL))
+  {
+    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    exit(1);
+  }
+  ts->capacity = cap;
+}
+
+/* Valor do lexema numérico srcBuf[lexStart..lexEnd), sem limite de tamanho */
+static int lexemeValue(void)
+{
+  unsigned int v = 0;
+  long p;
+  for (p = lexStart; p < lexEnd; p++)
+    v = v * 10 + (unsigned int)(srcBuf[p] - '0');
+  return (int)v;
+}
+
+/* Percorre o arquivo fonte inteiro de uma vez, preenchendo tokenStream;
+   o último token é sempre ENDFILE. Retorna o número de tokens */
+int scanTokens(void)
+{
+  TokenStream *ts = &tokenStream;
+  TokenType t;
+  ts->count = 0;
+  do
+  {
+    t = getToken();
+    if (ts->count == ts->capacity)
+      growTokens();
+    ts->kind[ts->count] = (unsigned char)t;
+    ts->offset[ts->count] = (int)lexStart;
+    ts->line[ts->count] = lineno;
+    if (t == NUM)
+      ts->value[ts->count] = lexemeValue();
+    else if (t == ID)
+      ts->value[ts->count] = tokenAtom;
+    else
+      ts->value[ts->count] = 0;
+    ts->count++;
+  } while (t != ENDFILE);
+  return ts->count;
+}
+
+/* Retorna o lexema completo do token i de tokenStream. Identificadores
+   vêm da tabela de átomos; os demais são relidos do buffer do código fonte */
+char *tokenLexeme(int i)
+{
+  static char buf[MAXTOKENLEN + 1];
+  TokenStream *ts = &tokenStream;
+  TokenType t = (TokenType)ts->kind[i];
+  long p = ts->offset[i];
+  int len = 0;
+  if (t == ID)
+    return atomName(ts->value[i]);
+  if (!charClassReady)
+    initCharClass();
+  if (t == NUM)
+    while ((p + len < srcLen) && (charClass[(unsigned char)srcBuf[p + len]] == C_DIGIT))
+      len++;
+  else if ((t >= IF) && (t < IF + MAXRESERVED))
+    while ((p + len < srcLen) &&
+           ((charClass[(unsigned char)srcBuf[p + len]] == C_LETTER) ||
+            (charClass[(unsigned char)srcBuf[p + len]] == C_DIGIT)))
+      len++;
+  else if (t == ASSIGN)
+    len = 2;
+  else if (t != ENDFILE)
+    len = 1;
+  if (len > MAXTOKENLEN)
+    len = MAXTOKENLEN;
+  memcpy(buf, srcBuf + p, len);
+  buf[len] = '\0';
+  return buf;
+}
+
+/* Libera a memória de tokenStream */
+void freeTokens(void)
+{
+  TokenStream *ts = &tokenStream;
+  free(ts->kind);
+  free(ts->offset);
+  free(ts->line);
+  free(ts->value);
+  memset(ts, 0, sizeof(TokenStream));
+}
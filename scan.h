@@ -16,8 +16,48 @@
 extern char tokenString[MAXTOKENLEN+1];
 //extern char *allocp = tokenString;
 
+/* tokenAtom is the atom (see intern.h) of the
+ * most recent ID token
+ */
+extern int tokenAtom;
+
 /* function getToken returns the 
  * next token in source file
  */
 TokenType getToken(void);
+
+/* TokenStream holds the whole token sequence of
+ * the source file as parallel arrays indexed by
+ * token number (filled by scanTokens)
+ */
+typedef struct
+{
+  int count;           /* number of tokens, ENDFILE included */
+  int capacity;
+  unsigned char *kind; /* TokenType of each token */
+  int *offset;         /* source offset of the lexeme */
+  int *line;           /* source line number of the token */
+  int *value;          /* NUM: value; ID: atom of the name */
+} TokenStream;
+
+extern TokenStream tokenStream;
+
+/* Function scanTokens scans the whole source
+ * file into tokenStream in a single pass and
+ * returns the number of tokens
+ */
+int scanTokens(void);
+
+/* Function tokenLexeme returns the lexeme of
+ * token i of tokenStream (untruncated for IDs)
+ */
+char *tokenLexeme(int i);
+
+/* Procedure freeTokens releases tokenStream */
+void freeTokens(void);
+
+/* Procedure releaseSource frees the in-memory
+ * copy of the source file kept by the scanner
+ */
+void releaseSource(void);
 #endif
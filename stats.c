@@ -0,0 +1,148 @@
+/****************************************************/
+/* File: stats.c                                    */
+/* Per-phase time and memory report implementation  */
+/****************************************************/
+
+#include "globals.h"
+#include "arena.h"
+#include "stats.h"
+#include <time.h>
+#if defined(_WIN32)
+#define HAVE_RUSAGE FALSE
+#else
+#define HAVE_RUSAGE TRUE
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+/* measurements of one phase */
+typedef struct
+{
+  int run;       /* TRUE once the phase was measured */
+  double wall;   /* seconds */
+  double cpu;    /* seconds */
+  long rssDelta; /* growth of the peak resident set, KB */
+  long allocs;   /* arena allocations */
+  long bytes;    /* arena bytes */
+  long items;
+  /* values at phaseBegin */
+  double wall0, cpu0;
+  long rss0, allocs0, bytes0;
+} PhaseStats;
+
+static PhaseStats phases[NUMPHASES];
+
+static char *phaseName[NUMPHASES] =
+    {"scan", "parse", "analyze", "optimize", "codegen", "peephole", "emit"};
+
+static char *itemName[NUMPHASES] =
+    {"tokens", "nodes", "nodes", "eliminated", "instructions", "removed", "instructions"};
+
+static double wallClock(void)
+{
+#if HAVE_RUSAGE
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+#else
+  return (double)time(NULL);
+#endif
+}
+
+/* peak resident set size in KB (0 if unknown) */
+static long peakRSS(void)
+{
+#if HAVE_RUSAGE
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+#if defined(__APPLE__)
+  return ru.ru_maxrss / 1024;
+#else
+  return ru.ru_maxrss;
+#endif
+#else
+  return 0;
+#endif
+}
+
+/* Procedure phaseBegin starts measuring phase p */
+void phaseBegin(Phase p)
+{
+  PhaseStats *ps = &phases[p];
+  ps->wall0 = wallClock();
+  ps->cpu0 = (double)clock() / CLOCKS_PER_SEC;
+  ps->rss0 = peakRSS();
+  ps->allocs0 = arenaCount();
+  ps->bytes0 = arenaBytes();
+}
+
+/* Procedure phaseEnd stops measuring phase p */
+void phaseEnd(Phase p, long items)
+{
+  PhaseStats *ps = &phases[p];
+  ps->run = TRUE;
+  ps->wall += wallClock() - ps->wall0;
+  ps->cpu += (double)clock() / CLOCKS_PER_SEC - ps->cpu0;
+  ps->rssDelta += peakRSS() - ps->rss0;
+  ps->allocs += arenaCount() - ps->allocs0;
+  ps->bytes += arenaBytes() - ps->bytes0;
+  ps->items += items;
+}
+
+/* prints s as a JSON string */
+static void printJsonString(FILE *out, char *s)
+{
+  fputc('"', out);
+  for (; *s != '\0'; s++)
+  {
+    if ((*s == '"') || (*s == '\\'))
+      fputc('\\', out);
+    if ((unsigned char)*s >= ' ')
+      fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+/* Procedure printTimeReport prints the report for
+ * file name pgm, as text or as JSON
+ */
+void printTimeReport(FILE *out, char *pgm, int json)
+{
+  int p;
+  int first = TRUE;
+  double wall = 0, cpu = 0;
+  if (json)
+  {
+    fprintf(out, "{\"file\": ");
+    printJsonString(out, pgm);
+    fprintf(out, ", \"peak_rss_kb\": %ld, \"phases\": [", peakRSS());
+    for (p = 0; p < NUMPHASES; p++)
+      if (phases[p].run)
+      {
+        PhaseStats *ps = &phases[p];
+        fprintf(out, "%s\n  {\"phase\": \"%s\", \"wall_ms\": %.3f, \"cpu_ms\": %.3f, "
+                     "\"rss_delta_kb\": %ld, \"allocs\": %ld, \"alloc_bytes\": %ld, "
+                     "\"%s\": %ld}",
+                first ? "" : ",", phaseName[p], ps->wall * 1000, ps->cpu * 1000,
+                ps->rssDelta, ps->allocs, ps->bytes, itemName[p], ps->items);
+        first = FALSE;
+      }
+    fprintf(out, "\n]}\n");
+    return;
+  }
+  fprintf(out, "\n===---------------------- time report ----------------------===\n");
+  fprintf(out, "  file: %s\n\n", pgm);
+  fprintf(out, "  %-10s %10s %10s %9s %9s %11s %10s\n",
+          "phase", "wall(ms)", "cpu(ms)", "rss(KB)", "allocs", "bytes", "items");
+  for (p = 0; p < NUMPHASES; p++)
+    if (phases[p].run)
+    {
+      PhaseStats *ps = &phases[p];
+      fprintf(out, "  %-10s %10.3f %10.3f %9ld %9ld %11ld %10ld %s\n",
+              phaseName[p], ps->wall * 1000, ps->cpu * 1000, ps->rssDelta,
+              ps->allocs, ps->bytes, ps->items, itemName[p]);
+      wall += ps->wall;
+      cpu += ps->cpu;
+    }
+  fprintf(out, "  %-10s %10.3f %10.3f %9ld\n", "total", wall * 1000, cpu * 1000, peakRSS());
+}
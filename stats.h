@@ -0,0 +1,37 @@
+/****************************************************/
+/* File: stats.h                                    */
+/* Per-phase time and memory report for the TINY    */
+/* compiler driver (-time-report)                   */
+/****************************************************/
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/* compiler phases measured by the report */
+typedef enum
+{
+  PhScan,
+  PhParse,
+  PhAnalyze,
+  PhOptimize,
+  PhCodeGen,
+  PhPeephole,
+  PhEmit,
+  NUMPHASES
+} Phase;
+
+/* Procedure phaseBegin starts measuring phase p */
+void phaseBegin(Phase p);
+
+/* Procedure phaseEnd stops measuring phase p and
+ * records items (tokens, nodes, symbols or
+ * instructions, depending on the phase)
+ */
+void phaseEnd(Phase p, long items);
+
+/* Procedure printTimeReport prints the report for
+ * file name pgm, as text or as JSON
+ */
+void printTimeReport(FILE *out, char *pgm, int json);
+
+#endif
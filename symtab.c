@@ -2,58 +2,120 @@
 /* File: symtab.c                                   */
 /* Symbol table implementation for the TINY compiler*/
 /* (allows only one symbol table)                   */
-/* Symbol table is implemented as a chained         */
-/* hash table                                       */
+/* Symbol table is an array indexed by the atom     */
+/* of each variable name                            */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
+#include "globals.h"
+#include "intern.h"
+#include "arena.h"
 #include "symtab.h"
 
-/* SIZE is the size of the hash table */
-#define SIZE 211
+/* The line numbers of the source code in which
+ * a variable is referenced are kept in a list
+ * of chunks; each chunk is twice the size of
+ * the previous one (up to MAXCHUNK lines), so
+ * appending a line is O(1) through the tail
+ */
+#define FIRSTCHUNK 4
+#define MAXCHUNK 4096
+
+typedef struct LineChunkRec
+   { int count; /* line numbers used in this chunk */
+     int size; /* line numbers that fit in it */
+     int * lines;
+     struct LineChunkRec * next;
+   } * LineChunk;
+
+/* The record for each variable, including
+ * assigned memory location, the number of
+ * references and the chunks of line numbers
+ * in which it appears in the source code
+ * (only while CrossRef is set). Records are
+ * indexed by the atom of the variable name
+ * (see intern.h)
+ */
+typedef struct SymbolRec
+   { int refs; /* 0 if the variable is not in the table */
+     int memloc ; /* memory location for variable */
+     LineChunk first, last;
+   } Symbol;
 
-/* SHIFT is the power of two used as multiplier
-   in hash function  */
-#define SHIFT 4
+/* the symbol table, indexed by atom */
+static Symbol * symbols = NULL;
+static int symCapacity = 0;
 
-/* the hash function */
-static int hash ( char * key )
-{ int temp = 0;
-  int i = 0;
-  while (key[i] != '\0')
-  { temp = ((temp << SHIFT) + key[i]) % SIZE;
-    ++i;
+/* Function newChunk returns an empty chunk
+ * of size line numbers from the arena
+ */
+static LineChunk newChunk( int size )
+{ LineChunk c = (LineChunk) arenaAlloc(sizeof(struct LineChunkRec) + size * sizeof(int));
+  if (c != NULL)
+  { c->size = size;
+    c->lines = (int *) (c + 1);
   }
-  return temp;
+  return c;
 }
 
-/* the list of line numbers of the source 
- * code in which a variable is referenced
+/* Procedure addLine appends lineno to the
+ * line numbers of the symbol l
  */
-typedef struct LineListRec
-   { int lineno;
-     struct LineListRec * next;
-   } * LineList;
+static void addLine( Symbol * l, int lineno )
+{ LineChunk t = l->last;
+  if ((t == NULL) || (t->count == t->size))
+  { LineChunk c = newChunk((t == NULL) ? FIRSTCHUNK :
+                           (t->size < MAXCHUNK) ? 2 * t->size : MAXCHUNK);
+    if (c == NULL) return;
+    if (t == NULL) l->first = c;
+    else t->next = c;
+    l->last = t = c;
+  }
+  t->lines[t->count++] = lineno;
+}
 
-/* The record in the bucket lists for
- * each variable, including name, 
- * assigned memory location, and
- * the list of line numbers in which
- * it appears in the source code
+/* Procedure st_insertAtom inserts line numbers and
+ * memory locations into the symbol table
+ * loc = memory location is inserted only the
+ * first time, otherwise ignored
  */
-typedef struct BucketListRec
-   { char * name;
-     LineList lines;
-     int memloc ; /* memory location for variable */
-     struct BucketListRec * next;
-   } * BucketList;
+void st_insertAtom( int atom, int lineno, int loc )
+{ Symbol * l;
+  if (atom >= symCapacity)
+  { int cap = (symCapacity == 0) ? 256 : symCapacity;
+    Symbol * table;
+    while (atom >= cap) cap *= 2;
+    table = (Symbol *) realloc(symbols, cap * sizeof(Symbol));
+    if (table == NULL) return;
+    memset(table + symCapacity, 0, (cap - symCapacity) * sizeof(Symbol));
+    symbols = table;
+    symCapacity = cap;
+  }
+  l = &symbols[atom];
+  if (l->refs == 0) /* variable not yet in table */
+    l->memloc = loc;
+  l->refs++;
+  if (CrossRef) addLine(l, lineno);
+} /* st_insertAtom */
 
-/* the hash table */
-static BucketList hashTable[SIZE];
+/* Function st_lookupAtom returns the memory 
+ * location of a variable or -1 if not found
+ */
+int st_lookupAtom ( int atom )
+{ if ((atom < 0) || (atom >= symCapacity) || (symbols[atom].refs == 0))
+    return -1;
+  return symbols[atom].memloc;
+}
+
+/* Procedure freeSymTab empties the symbol table;
+ * line chunks belong to the arena
+ */
+void freeSymTab( void )
+{ free(symbols);
+  symbols = NULL;
+  symCapacity = 0;
+}
 
 /* Procedure st_insert inserts line numbers and
  * memory locations into the symbol table
@@ -61,38 +123,14 @@ static BucketList hashTable[SIZE];
  * first time, otherwise ignored
  */
 void st_insert( char * name, int lineno, int loc )
-{ int h = hash(name);
-  BucketList l =  hashTable[h];
-  while ((l != NULL) && (strcmp(name,l->name) != 0))
-    l = l->next;
-  if (l == NULL) /* variable not yet in table */
-  { l = (BucketList) malloc(sizeof(struct BucketListRec));
-    l->name = name;
-    l->lines = (LineList) malloc(sizeof(struct LineListRec));
-    l->lines->lineno = lineno;
-    l->memloc = loc;
-    l->lines->next = NULL;
-    l->next = hashTable[h];
-    hashTable[h] = l; }
-  else /* found in table, so just add line number */
-  { LineList t = l->lines;
-    while (t->next != NULL) t = t->next;
-    t->next = (LineList) malloc(sizeof(struct LineListRec));
-    t->next->lineno = lineno;
-    t->next->next = NULL;
-  }
+{ st_insertAtom(internName(name, (int) strlen(name)), lineno, loc);
 } /* st_insert */
 
 /* Function st_lookup returns the memory 
  * location of a variable or -1 if not found
  */
 int st_lookup ( char * name )
-{ int h = hash(name);
-  BucketList l =  hashTable[h];
-  while ((l != NULL) && (strcmp(name,l->name) != 0))
-    l = l->next;
-  if (l == NULL) return -1;
-  else return l->memloc;
+{ return st_lookupAtom(findName(name));
 }
 
 /* Procedure printSymTab prints a formatted 
@@ -103,20 +141,57 @@ void printSymTab(FILE * listing)
 { int i;
   fprintf(listing,"Variable Name  Location   Line Numbers\n");
   fprintf(listing,"-------------  --------   ------------\n");
-  for (i=0;i<SIZE;++i)
-  { if (hashTable[i] != NULL)
-    { BucketList l = hashTable[i];
-      while (l != NULL)
-      { LineList t = l->lines;
-        fprintf(listing,"%-14s ",l->name);
-        fprintf(listing,"%-8d  ",l->memloc);
-        while (t != NULL)
-        { fprintf(listing,"%4d ",t->lineno);
-          t = t->next;
-        }
-        fprintf(listing,"\n");
-        l = l->next;
+  for (i=0;i<symCapacity;++i)
+  { if (symbols[i].refs != 0)
+    { LineChunk t = symbols[i].first;
+      int j;
+      fprintf(listing,"%-14s ",atomName(i));
+      fprintf(listing,"%-8d  ",symbols[i].memloc);
+      while (t != NULL)
+      { for (j=0;j<t->count;j++)
+          fprintf(listing,"%4d ",t->lines[j]);
+        t = t->next;
       }
+      fprintf(listing,"\n");
     }
   }
 } /* printSymTab */
+
+/* Function st_references copies into lines (at
+ * most max of them) the line numbers in which
+ * the variable name is referenced and returns
+ * how many there are
+ */
+int st_references( char * name, int * lines, int max )
+{ int atom = findName(name);
+  int n = 0, j;
+  LineChunk t;
+  if ((atom < 0) || (atom >= symCapacity)) return 0;
+  for (t = symbols[atom].first; t != NULL; t = t->next)
+    for (j=0;j<t->count;j++,n++)
+      if (n < max) lines[n] = t->lines[j];
+  return n;
+} /* st_references */
+
+/* Function st_namesInLines copies into atoms (at
+ * most max of them, in atom order) the variables
+ * referenced somewhere in the lines first to last
+ * and returns how many there are
+ */
+int st_namesInLines( int first, int last, int * atoms, int max )
+{ int n = 0, i, j;
+  for (i=0;i<symCapacity;++i)
+  { LineChunk t = symbols[i].first;
+    int found = FALSE;
+    while ((t != NULL) && !found)
+    { for (j=0;(j<t->count) && !found;j++)
+        found = (t->lines[j] >= first) && (t->lines[j] <= last);
+      t = t->next;
+    }
+    if (found)
+    { if (n < max) atoms[n] = i;
+      n++;
+    }
+  }
+  return n;
+} /* st_namesInLines */
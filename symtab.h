@@ -21,6 +21,34 @@ void st_insert( char * name, int lineno, int loc );
  */
 int st_lookup ( char * name );
 
+/* Procedure st_insertAtom and function
+ * st_lookupAtom are the same operations keyed
+ * by the atom of the name (see intern.h);
+ * they only index an array
+ */
+void st_insertAtom( int atom, int lineno, int loc );
+int st_lookupAtom ( int atom );
+
+/* Procedure freeSymTab empties the symbol
+ * table (call before arenaFree)
+ */
+void freeSymTab( void );
+
+/* Function st_references copies into lines
+ * (at most max of them) the line numbers in
+ * which the variable name is referenced and
+ * returns how many there are; line numbers are
+ * only recorded while CrossRef is set
+ */
+int st_references( char * name, int * lines, int max );
+
+/* Function st_namesInLines copies into atoms
+ * (at most max of them) the atoms of the
+ * variables referenced in the lines first to
+ * last and returns how many there are
+ */
+int st_namesInLines( int first, int last, int * atoms, int max );
+
 /* Procedure printSymTab prints a formatted 
  * listing of the symbol table contents 
  * to the listing file
@@ -9,6 +9,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include "tmb.h"
+
+/* A binary object (.tmb) is loaded whole: mapped with
+   mmap when the system allows, read with fread otherwise */
+#if defined(_WIN32)
+#define USE_MMAP FALSE
+#else
+#define USE_MMAP TRUE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
 
 #ifndef TRUE
 #define TRUE 1
@@ -18,8 +31,8 @@
 #endif
 
 /******* const *******/
-#define IADDR_SIZE 1024 /* increase for large programs */
-#define DADDR_SIZE 1024 /* increase for large programs */
+#define IADDR_SIZE (1024 * 1024) /* increase for large programs */
+#define DADDR_SIZE (64 * 1024)   /* increase for large programs */
 #define NO_REGS 8
 #define PC_REG 7
 
@@ -70,7 +83,8 @@ typedef enum
   srHALT,
   srIMEM_ERR,
   srDMEM_ERR,
-  srZERODIVIDE
+  srZERODIVIDE,
+  srIN_ERR
 } STEPRESULT;
 
 typedef struct
@@ -86,8 +100,10 @@ int iloc = 0;
 int dloc = 0;
 int traceflag = FALSE;
 int icountflag = FALSE;
+int batch = FALSE; /* -run: no prompts, plain IN/OUT values */
 
 INSTRUCTION iMem[IADDR_SIZE];
+int iMemSize = 0; /* locations loaded, from 0 */
 int dMem[DADDR_SIZE];
 int reg[NO_REGS];
 
@@ -100,11 +116,20 @@ char *opCodeTab[] = {
 };
 
 char *stepResultTab[] = {"OK", "Halted", "Instruction Memory Fault",
-                         "Data Memory Fault", "Division by 0"};
+                         "Data Memory Fault", "Division by 0",
+                         "No value for IN instruction"};
 
-char pgmName[20];
+char *pgmName;
 FILE *pgm;
 
+/* the binary object, and its data and debug sections */
+unsigned char *objBuf = NULL;
+long objLen = 0;
+unsigned char *objData = NULL;
+int numData = 0;
+char **iComment = NULL;
+int numComments = 0;
+
 char in_Line[LINESIZE];
 int lineLen;
 int inCol;
@@ -141,6 +166,8 @@ void writeInstruction(int loc)
       printf("%3d(%1d)", iMem[loc].iarg2, iMem[loc].iarg3);
       break;
     }
+    if ((loc < numComments) && (iComment[loc][0] != '\0'))
+      printf("\t%s", iComment[loc]);
     printf("\n");
   }
 } /* writeInstruction */
@@ -249,16 +276,37 @@ int error(char *msg, int lineNo, int instNo)
 } /* error */
 
 /********************************************/
-int readInstructions(void)
-{
-  OPCODE op;
-  int arg1, arg2, arg3;
-  int loc, regNo, lineNo;
+int getInt(unsigned char *p)
+{ /* 32-bit little endian two's complement */
+  unsigned long u = (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+                    ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+  if (u & 0x80000000UL)
+    return -(int)(~u & 0x7fffffffUL) - 1;
+  return (int)u;
+} /* getInt */
+
+/********************************************/
+void clearMachine(void)
+{ /* registers and data memory, with the data
+     section of a binary object */
+  int regNo, loc, i;
   for (regNo = 0; regNo < NO_REGS; regNo++)
     reg[regNo] = 0;
   dMem[0] = DADDR_SIZE - 1;
   for (loc = 1; loc < DADDR_SIZE; loc++)
     dMem[loc] = 0;
+  for (i = 0; i < numData; i++)
+    dMem[getInt(objData + i * TMB_DATASIZE)] =
+        getInt(objData + i * TMB_DATASIZE + 4);
+} /* clearMachine */
+
+/********************************************/
+int readInstructions(void)
+{
+  OPCODE op;
+  int arg1, arg2, arg3;
+  int loc, lineNo;
+  clearMachine();
   for (loc = 0; loc < IADDR_SIZE; loc++)
   {
     iMem[loc].iop = opHALT;
@@ -282,7 +330,7 @@ int readInstructions(void)
       if (!getNum())
         return error("Bad location", lineNo, -1);
       loc = num;
-      if (loc > IADDR_SIZE)
+      if (loc >= IADDR_SIZE)
         return error("Location too large", lineNo, loc);
       if (!skipCh(':'))
         return error("Missing colon", lineNo, loc);
@@ -334,21 +382,213 @@ int readInstructions(void)
       iMem[loc].iarg1 = arg1;
       iMem[loc].iarg2 = arg2;
       iMem[loc].iarg3 = arg3;
+      if (loc >= iMemSize)
+        iMemSize = loc + 1;
     }
   }
   return TRUE;
 } /* readInstructions */
 
+/********************************************/
+int objError(char *msg, int instNo)
+{
+  printf("%s", pgmName);
+  if (instNo >= 0)
+    printf(" (Instruction %d)", instNo);
+  printf("   %s\n", msg);
+  return FALSE;
+} /* objError */
+
+/********************************************/
+int loadObject(void)
+{ /* the whole file into objBuf */
+  long cap;
+  size_t n;
+#if USE_MMAP
+  struct stat st;
+  int fd = fileno(pgm);
+  if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0))
+  {
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED)
+    {
+      objBuf = (unsigned char *)p;
+      objLen = (long)st.st_size;
+      return TRUE;
+    }
+  }
+#endif
+  cap = 64 * 1024;
+  objBuf = (unsigned char *)malloc(cap);
+  while ((objBuf != NULL) &&
+         ((n = fread(objBuf + objLen, 1, cap - objLen, pgm)) > 0))
+  {
+    objLen += (long)n;
+    if (objLen == cap)
+    {
+      unsigned char *p = (unsigned char *)realloc(objBuf, cap * 2);
+      if (p == NULL)
+      {
+        free(objBuf);
+        objBuf = NULL;
+        break;
+      }
+      objBuf = p;
+      cap *= 2;
+    }
+  }
+  return objBuf != NULL;
+} /* loadObject */
+
+/********************************************/
+int readObject(void)
+{ /* a binary object (tmb.h), checked as it is
+     decoded into iMem; locations past the code
+     keep the HALT 0,0,0 of the initial iMem */
+  unsigned char *p, *end;
+  int count, debugSize, loc;
+  if (!loadObject())
+    return objError("Cannot read object", -1);
+  if ((objLen < TMB_HEADERSIZE) || (memcmp(objBuf, TMB_MAGIC, 4) != 0))
+    return objError("Bad object header", -1);
+  if (getInt(objBuf + 4) != TMB_VERSION)
+    return objError("Unsupported object version", -1);
+  count = getInt(objBuf + 8);
+  numData = getInt(objBuf + 12);
+  debugSize = getInt(objBuf + 16);
+  if ((count < 0) || (count > IADDR_SIZE))
+    return objError("Bad instruction count", -1);
+  if ((numData < 0) || (numData > DADDR_SIZE) || (debugSize < 0) ||
+      ((objLen - TMB_HEADERSIZE) / TMB_INSTRSIZE < count) ||
+      (objLen - TMB_HEADERSIZE - (long)count * TMB_INSTRSIZE !=
+       (long)numData * TMB_DATASIZE + debugSize))
+    return objError("Bad object size", -1);
+  p = objBuf + TMB_HEADERSIZE;
+  for (loc = 0; loc < count; loc++, p += TMB_INSTRSIZE)
+  {
+    int op = p[0];
+    if ((op >= opRALim) || (op == opRRLim) || (op == opRMLim))
+      return objError("Illegal opcode", loc);
+    if ((p[1] >= NO_REGS) || (p[2] >= NO_REGS))
+      return objError("Bad register", loc);
+    iMem[loc].iop = op;
+    iMem[loc].iarg1 = p[1];
+    iMem[loc].iarg2 = getInt(p + 4);
+    iMem[loc].iarg3 = p[2];
+    if ((opClass(op) == opclRR) &&
+        ((iMem[loc].iarg2 < 0) || (iMem[loc].iarg2 >= NO_REGS)))
+      return objError("Bad register", loc);
+  }
+  objData = p;
+  for (loc = 0; loc < numData; loc++, p += TMB_DATASIZE)
+    if ((getInt(p) < 0) || (getInt(p) >= DADDR_SIZE))
+      return objError("Bad data address", -1);
+  if (debugSize > 0)
+  { /* one comment per instruction */
+    end = p + debugSize;
+    if (end[-1] != '\0')
+      return objError("Bad debug section", -1);
+    iComment = (char **)malloc((count + 1) * sizeof(char *));
+    if (iComment == NULL)
+      return objError("Out of memory", -1);
+    for (loc = 0; (loc < count) && (p < end); loc++)
+    {
+      iComment[loc] = (char *)p;
+      p += strlen((char *)p) + 1;
+    }
+    if ((loc < count) || (p != end))
+      return objError("Bad debug section", -1);
+    numComments = count;
+  }
+  iMemSize = count;
+  clearMachine();
+  return TRUE;
+} /* readObject */
+
+/********************************************/
+int readLine(void)
+{ /* a line of the terminal into in_Line,
+     FALSE at end of input */
+  if (fgets(in_Line, LINESIZE, stdin) == NULL)
+    return FALSE;
+  lineLen = strlen(in_Line);
+  if ((lineLen > 0) && (in_Line[lineLen - 1] == '\n'))
+    in_Line[--lineLen] = '\0';
+  inCol = 0;
+  return TRUE;
+} /* readLine */
+
+/********************************************/
+int readInt(int *value)
+{ /* the next integer of the input, for -run */
+  unsigned int n = 0;
+  int c, neg = FALSE, digits = FALSE;
+  do
+    c = getchar();
+  while (isspace(c));
+  if ((c == '-') || (c == '+'))
+  {
+    neg = (c == '-');
+    c = getchar();
+  }
+  while (isdigit(c))
+  {
+    n = n * 10 + (c - '0');
+    digits = TRUE;
+    c = getchar();
+  }
+  if (c != EOF)
+    ungetc(c, stdin);
+  *value = (int)(neg ? 0u - n : n);
+  return digits;
+} /* readInt */
+
+/********************************************/
+int readValue(int *value)
+{ /* the value of an IN instruction, FALSE if
+     there is none */
+  int ok;
+  if (batch)
+    return readInt(value);
+  do
+  {
+    printf("Enter value for IN instruction: ");
+    fflush(stdout);
+    if (!readLine())
+      return FALSE;
+    ok = getNum();
+    if (!ok)
+      printf("Illegal value\n");
+  } while (!ok);
+  *value = num;
+  return TRUE;
+} /* readValue */
+
+/********************************************/
+void writeValue(int value)
+{ /* the value of an OUT instruction */
+  if (batch)
+    printf("%d\n", value);
+  else
+    printf("OUT instruction prints: %d\n", value);
+} /* writeValue */
+
+/********************************************/
+void writeHalt(int r, int s, int t)
+{
+  if (!batch)
+    printf("HALT: %1d,%1d,%1d\n", r, s, t);
+} /* writeHalt */
+
 /********************************************/
 STEPRESULT stepTM(void)
 {
   INSTRUCTION currentinstruction;
   int pc;
   int r, s, t, m;
-  int ok;
 
   pc = reg[PC_REG];
-  if ((pc < 0) || (pc > IADDR_SIZE))
+  if ((pc < 0) || (pc >= IADDR_SIZE))
     return srIMEM_ERR;
   reg[PC_REG] = pc + 1;
   currentinstruction = iMem[pc];
@@ -366,7 +606,7 @@ STEPRESULT stepTM(void)
     r = currentinstruction.iarg1;
     s = currentinstruction.iarg3;
     m = currentinstruction.iarg2 + reg[s];
-    if ((m < 0) || (m > DADDR_SIZE))
+    if ((m < 0) || (m >= DADDR_SIZE))
       return srDMEM_ERR;
     break;
 
@@ -382,30 +622,18 @@ STEPRESULT stepTM(void)
   { /* RR instructions */
   case opHALT:
     /***********************************/
-    printf("HALT: %1d,%1d,%1d\n", r, s, t);
+    writeHalt(r, s, t);
     return srHALT;
     /* break; */
 
   case opIN:
     /***********************************/
-    do
-    {
-      printf("Enter value for IN instruction: ");
-      fflush(stdin);
-      fflush(stdout);
-      gets(in_Line);
-      lineLen = strlen(in_Line);
-      inCol = 0;
-      ok = getNum();
-      if (!ok)
-        printf("Illegal value\n");
-      else
-        reg[r] = num;
-    } while (!ok);
+    if (!readValue(&reg[r]))
+      return srIN_ERR;
     break;
 
   case opOUT:
-    printf("OUT instruction prints: %d\n", reg[r]);
+    writeValue(reg[r]);
     break;
   case opADD:
     reg[r] = reg[s] + reg[t];
@@ -470,6 +698,1108 @@ STEPRESULT stepTM(void)
   return srOKAY;
 } /* stepTM */
 
+/********************************************/
+/* The threaded engine runs the program until */
+/* it stops, with the results of stepTM. iMem */
+/* is decoded once into DINSTR records: the    */
+/* handler, operands, pc-relative addresses    */
+/* made absolute. The handler is a label       */
+/* address (computed goto) when the compiler   */
+/* allows, a switch case otherwise             */
+/********************************************/
+
+#if defined(__GNUC__)
+#define THREADED TRUE
+#else
+#define THREADED FALSE
+#endif
+
+/* register always 0, base of absolute addresses */
+#define ZERO_REG NO_REGS
+
+typedef enum
+{
+  hHALT, hIN, hOUT, hADD, hSUB, hMUL, hDIV, /* as the RR opcodes */
+  hLD, hST, hLDA, hLDC,
+  hJLT, hJLE, hJGT, hJGE, hJEQ, hJNE, /* d is the target */
+  hGOTO,  /* jump to d */
+  hJUMP,  /* jump to d+reg(s) */
+  hSLOW,  /* uses the pc as a register: run by stepTM */
+  hFAULT  /* the location past IADDR_SIZE */
+} HANDLER;
+
+typedef struct
+{
+#if THREADED
+  void *h;
+#endif
+  HANDLER op;
+  int r, s, t, d;
+} DINSTR;
+
+DINSTR *dCode = NULL;
+
+/********************************************/
+int staticTarget(DINSTR *di)
+{
+  return (di->s == ZERO_REG) && (di->d >= 0) && (di->d <= iMemSize);
+} /* staticTarget */
+
+/********************************************/
+HANDLER decodeOp(int loc, DINSTR *di)
+{
+  INSTRUCTION *in = &iMem[loc];
+  di->r = in->iarg1;
+  if (opClass(in->iop) == opclRR)
+  {
+    di->s = in->iarg2;
+    di->t = in->iarg3;
+    di->d = 0;
+    switch (in->iop)
+    {
+    case opHALT:
+      return hHALT;
+    case opIN:
+    case opOUT:
+      return (di->r == PC_REG) ? hSLOW : (HANDLER)in->iop;
+    default:
+      if ((di->r == PC_REG) || (di->s == PC_REG) || (di->t == PC_REG))
+        return hSLOW;
+      return (HANDLER)in->iop;
+    }
+  }
+  di->s = in->iarg3;
+  di->t = 0;
+  di->d = in->iarg2;
+  if (in->iop == opLDC)
+  {
+    di->s = ZERO_REG;
+    if (di->r != PC_REG)
+      return hLDC;
+    return staticTarget(di) ? hGOTO : hJUMP;
+  }
+  if (di->s == PC_REG)
+  { /* pc-relative: the address is known */
+    di->s = ZERO_REG;
+    di->d += loc + 1;
+  }
+  switch (in->iop)
+  {
+  case opLD:
+    return (di->r == PC_REG) ? hSLOW : hLD;
+  case opST:
+    return (di->r == PC_REG) ? hSLOW : hST;
+  case opLDA:
+    if (di->r != PC_REG)
+      return hLDA;
+    return staticTarget(di) ? hGOTO : hJUMP;
+  default: /* conditional jumps */
+    if ((di->r == PC_REG) || !staticTarget(di))
+      return hSLOW;
+    return (HANDLER)(hJLT + (in->iop - opJLT));
+  }
+} /* decodeOp */
+
+/********************************************/
+STEPRESULT runTM(long *count)
+{
+  int rg[NO_REGS + 1]; /* with ZERO_REG */
+  int *dm = dMem;
+  DINSTR *code, *ip;
+  long steps = 0;
+  int pc, m, i;
+  STEPRESULT result;
+#if THREADED
+  static void *label[] = {
+      &&L_hHALT, &&L_hIN, &&L_hOUT, &&L_hADD, &&L_hSUB, &&L_hMUL, &&L_hDIV,
+      &&L_hLD, &&L_hST, &&L_hLDA, &&L_hLDC,
+      &&L_hJLT, &&L_hJLE, &&L_hJGT, &&L_hJGE, &&L_hJEQ, &&L_hJNE,
+      &&L_hGOTO, &&L_hJUMP, &&L_hSLOW, &&L_hFAULT};
+#define CASE(h) L_##h:
+#define NEXT          \
+  do                  \
+  {                   \
+    steps++;          \
+    goto *ip->h;      \
+  } while (0)
+#else
+#define CASE(h) case h:
+#define NEXT   \
+  do           \
+  {            \
+    steps++;   \
+    goto next; \
+  } while (0)
+#endif
+
+  if (dCode == NULL)
+  { /* iMem does not change once loaded */
+    dCode = (DINSTR *)malloc((iMemSize + 1) * sizeof(DINSTR));
+    if (dCode == NULL)
+    {
+      printf("Out of memory\n");
+      exit(1);
+    }
+    for (i = 0; i <= iMemSize; i++)
+    {
+      if (i < IADDR_SIZE)
+        dCode[i].op = decodeOp(i, &dCode[i]);
+      else
+        dCode[i].op = hFAULT;
+#if THREADED
+      dCode[i].h = label[dCode[i].op];
+#endif
+    }
+  }
+  code = dCode;
+  for (i = 0; i < NO_REGS; i++)
+    rg[i] = reg[i];
+  rg[ZERO_REG] = 0;
+  pc = reg[PC_REG];
+
+jump: /* to pc */
+  if ((pc >= 0) && (pc <= iMemSize))
+  {
+    ip = code + pc;
+    NEXT;
+  }
+  steps++;
+  if ((pc < 0) || (pc >= IADDR_SIZE))
+  {
+    result = srIMEM_ERR;
+    goto done;
+  }
+  /* past the program: HALT 0,0,0 */
+  writeHalt(iMem[pc].iarg1, iMem[pc].iarg2, iMem[pc].iarg3);
+  pc++;
+  result = srHALT;
+  goto done;
+
+stop: /* result of the instruction at ip */
+  pc = (int)(ip - code) + 1;
+  goto done;
+
+#if !THREADED
+next:
+  switch (ip->op)
+  {
+#endif
+  CASE(hHALT)
+    writeHalt(ip->r, ip->s, ip->t);
+    result = srHALT;
+    goto stop;
+  CASE(hIN)
+    if (!readValue(&rg[ip->r]))
+    {
+      result = srIN_ERR;
+      goto stop;
+    }
+    ip++;
+    NEXT;
+  CASE(hOUT)
+    writeValue(rg[ip->r]);
+    ip++;
+    NEXT;
+  CASE(hADD)
+    rg[ip->r] = rg[ip->s] + rg[ip->t];
+    ip++;
+    NEXT;
+  CASE(hSUB)
+    rg[ip->r] = rg[ip->s] - rg[ip->t];
+    ip++;
+    NEXT;
+  CASE(hMUL)
+    rg[ip->r] = rg[ip->s] * rg[ip->t];
+    ip++;
+    NEXT;
+  CASE(hDIV)
+    if (rg[ip->t] == 0)
+    {
+      result = srZERODIVIDE;
+      goto stop;
+    }
+    rg[ip->r] = rg[ip->s] / rg[ip->t];
+    ip++;
+    NEXT;
+  CASE(hLD)
+    m = ip->d + rg[ip->s];
+    if ((m < 0) || (m >= DADDR_SIZE))
+    {
+      result = srDMEM_ERR;
+      goto stop;
+    }
+    rg[ip->r] = dm[m];
+    ip++;
+    NEXT;
+  CASE(hST)
+    m = ip->d + rg[ip->s];
+    if ((m < 0) || (m >= DADDR_SIZE))
+    {
+      result = srDMEM_ERR;
+      goto stop;
+    }
+    dm[m] = rg[ip->r];
+    ip++;
+    NEXT;
+  CASE(hLDA)
+    rg[ip->r] = ip->d + rg[ip->s];
+    ip++;
+    NEXT;
+  CASE(hLDC)
+    rg[ip->r] = ip->d;
+    ip++;
+    NEXT;
+  CASE(hJLT)
+    ip = (rg[ip->r] < 0) ? code + ip->d : ip + 1;
+    NEXT;
+  CASE(hJLE)
+    ip = (rg[ip->r] <= 0) ? code + ip->d : ip + 1;
+    NEXT;
+  CASE(hJGT)
+    ip = (rg[ip->r] > 0) ? code + ip->d : ip + 1;
+    NEXT;
+  CASE(hJGE)
+    ip = (rg[ip->r] >= 0) ? code + ip->d : ip + 1;
+    NEXT;
+  CASE(hJEQ)
+    ip = (rg[ip->r] == 0) ? code + ip->d : ip + 1;
+    NEXT;
+  CASE(hJNE)
+    ip = (rg[ip->r] != 0) ? code + ip->d : ip + 1;
+    NEXT;
+  CASE(hGOTO)
+    ip = code + ip->d;
+    NEXT;
+  CASE(hJUMP)
+    pc = ip->d + rg[ip->s];
+    goto jump;
+  CASE(hSLOW)
+    for (i = 0; i < NO_REGS; i++)
+      reg[i] = rg[i];
+    reg[PC_REG] = (int)(ip - code);
+    result = stepTM();
+    for (i = 0; i < NO_REGS; i++)
+      rg[i] = reg[i];
+    pc = reg[PC_REG];
+    if (result != srOKAY)
+      goto done;
+    goto jump;
+  CASE(hFAULT)
+    pc = (int)(ip - code);
+    result = srIMEM_ERR;
+    goto done;
+#if !THREADED
+  }
+#endif
+
+done:
+  for (i = 0; i < NO_REGS; i++)
+    reg[i] = rg[i];
+  reg[PC_REG] = pc;
+  *count += steps;
+  return result;
+#undef CASE
+#undef NEXT
+} /* runTM */
+
+/********************************************/
+/* The JIT translates iMem into x86-64 code    */
+/* (System V ABI). TM registers 0-6 live in    */
+/* r8d-r14d, rbx points to reg and r15 to      */
+/* dMem. Static jumps become direct branches,  */
+/* computed ones go through a table of native  */
+/* addresses. IN and OUT call readValue and    */
+/* writeValue. A fault or HALT leaves the      */
+/* native code with the pc in reg[PC_REG] and  */
+/* the STEPRESULT; what decodeOp hands to      */
+/* stepTM leaves it with JIT_STEP              */
+/********************************************/
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define USE_JIT TRUE
+#else
+#define USE_JIT FALSE
+#endif
+
+int jitflag = FALSE;
+
+#if USE_JIT
+
+#define JIT_STEP (-1)
+
+/* x86-64 registers */
+#define RAX 0
+#define RCX 1
+#define RBX 3
+#define R15 15
+#define HOSTREG(r) (8 + (r))
+
+/* condition codes of jcc */
+#define CC_B 0x2
+#define CC_AE 0x3
+#define CC_E 0x4
+#define CC_NE 0x5
+#define CC_A 0x7
+#define CC_L 0xC
+#define CC_GE 0xD
+#define CC_LE 0xE
+#define CC_G 0xF
+
+typedef int (*JITENTRY)(void *start);
+
+typedef enum
+{
+  fixLabel,  /* branch to location loc */
+  fixExit,   /* leave with pc = loc and result code */
+  fixExitEax /* leave with pc = eax, to be stepped */
+} FIXKIND;
+
+typedef struct
+{
+  long pos; /* of the rel32 */
+  FIXKIND kind;
+  int loc, code;
+} JITFIXUP;
+
+unsigned char *jBuf = NULL; /* code being emitted */
+long jLen = 0, jCap = 0;
+long *jLabel = NULL; /* offset of each location */
+JITFIXUP *jFix = NULL;
+int numFix = 0, fixCap = 0;
+long jEpilogue;
+int jitFailed = FALSE;
+
+void **jTable = NULL; /* native address of each location */
+JITENTRY jEntry = NULL;
+
+/********************************************/
+void jByte(int b)
+{
+  if (jitFailed)
+    return;
+  if (jLen == jCap)
+  {
+    unsigned char *p;
+    long cap = (jCap == 0) ? 64 * 1024 : jCap * 2;
+    p = (unsigned char *)realloc(jBuf, cap);
+    if (p == NULL)
+    {
+      jitFailed = TRUE;
+      return;
+    }
+    jBuf = p;
+    jCap = cap;
+  }
+  jBuf[jLen++] = (unsigned char)b;
+} /* jByte */
+
+/********************************************/
+void jInt(int n)
+{
+  unsigned int u = (unsigned int)n;
+  jByte(u & 0xff);
+  jByte((u >> 8) & 0xff);
+  jByte((u >> 16) & 0xff);
+  jByte((u >> 24) & 0xff);
+} /* jInt */
+
+/********************************************/
+void jPtr(void *p)
+{
+  unsigned long long u = (unsigned long long)(size_t)p;
+  jInt((int)(u & 0xffffffffu));
+  jInt((int)(u >> 32));
+} /* jPtr */
+
+/********************************************/
+void jRex(int w, int reg, int base)
+{
+  int b = 0x40 | (w << 3) | ((reg & 8) >> 1) | ((base & 8) >> 3);
+  if (b != 0x40)
+    jByte(b);
+} /* jRex */
+
+#define MODRM(mod, reg, rm) (((mod) << 6) | (((reg)&7) << 3) | ((rm)&7))
+
+/********************************************/
+void jOpRR(int op, int rm, int reg)
+{ /* op r/m32, r32 */
+  jRex(0, reg, rm);
+  jByte(op);
+  jByte(MODRM(3, reg, rm));
+} /* jOpRR */
+
+#define jMov(dst, src) jOpRR(0x89, dst, src)
+#define jAdd(dst, src) jOpRR(0x01, dst, src)
+#define jSub(dst, src) jOpRR(0x29, dst, src)
+#define jTest(r) jOpRR(0x85, r, r)
+
+/********************************************/
+void jImul(int dst, int src)
+{
+  jRex(0, dst, src);
+  jByte(0x0F);
+  jByte(0xAF);
+  jByte(MODRM(3, dst, src));
+} /* jImul */
+
+/********************************************/
+void jMovI(int dst, int imm)
+{
+  jRex(0, 0, dst);
+  jByte(0xB8 + (dst & 7));
+  jInt(imm);
+} /* jMovI */
+
+/********************************************/
+void jLea(int dst, int base, int disp)
+{ /* dst = base + disp, 32 bits */
+  jRex(0, dst, base);
+  jByte(0x8D);
+  jByte(MODRM(2, dst, base));
+  if ((base & 7) == 4)
+    jByte(0x24); /* SIB: no index */
+  jInt(disp);
+} /* jLea */
+
+/********************************************/
+void jReg(int op, int r, int tmReg)
+{ /* op r, reg[tmReg] (0x8B load, 0x89 store) */
+  jRex(0, r, RBX);
+  jByte(op);
+  jByte(MODRM(1, r, RBX));
+  jByte(4 * tmReg);
+} /* jReg */
+
+/********************************************/
+void jMem(int op, int r, int addr)
+{ /* op r, dMem[addr] */
+  jRex(0, r, R15);
+  jByte(op);
+  jByte(MODRM(2, r, R15));
+  jInt(4 * addr);
+} /* jMem */
+
+/********************************************/
+void jMemEax(int op, int r)
+{ /* op r, dMem[eax] */
+  jRex(0, r, R15);
+  jByte(op);
+  jByte(MODRM(0, r, 4));
+  jByte(0x80 | (RAX << 3) | (R15 & 7)); /* SIB: r15 + rax*4 */
+} /* jMemEax */
+
+/********************************************/
+void jFixup(FIXKIND kind, int loc, int code)
+{ /* the rel32 to be emitted next */
+  if (jitFailed)
+    return;
+  if (numFix == fixCap)
+  {
+    JITFIXUP *p;
+    int cap = (fixCap == 0) ? 1024 : fixCap * 2;
+    p = (JITFIXUP *)realloc(jFix, cap * sizeof(JITFIXUP));
+    if (p == NULL)
+    {
+      jitFailed = TRUE;
+      return;
+    }
+    jFix = p;
+    fixCap = cap;
+  }
+  jFix[numFix].pos = jLen;
+  jFix[numFix].kind = kind;
+  jFix[numFix].loc = loc;
+  jFix[numFix].code = code;
+  numFix++;
+  jInt(0);
+} /* jFixup */
+
+/********************************************/
+void jPatch(long pos, long target)
+{
+  long save = jLen;
+  jLen = pos;
+  jInt((int)(target - (pos + 4)));
+  jLen = save;
+} /* jPatch */
+
+/********************************************/
+void jJcc(int cc, FIXKIND kind, int loc, int code)
+{
+  jByte(0x0F);
+  jByte(0x80 | cc);
+  jFixup(kind, loc, code);
+} /* jJcc */
+
+/********************************************/
+void jJmp(FIXKIND kind, int loc, int code)
+{
+  jByte(0xE9);
+  jFixup(kind, loc, code);
+} /* jJmp */
+
+/********************************************/
+void jExit(int pc, int code)
+{ /* reg[PC_REG] = pc, return code */
+  jByte(0xC7);
+  jByte(MODRM(1, 0, RBX));
+  jByte(4 * PC_REG);
+  jInt(pc);
+  jMovI(RAX, code);
+  jByte(0xE9);
+  jInt((int)(jEpilogue - (jLen + 4)));
+} /* jExit */
+
+/********************************************/
+void jCall(void *f)
+{ /* registers are saved in reg around the call */
+  int r;
+  for (r = 0; r < PC_REG; r++)
+    jReg(0x89, HOSTREG(r), r);
+  jByte(0x48); /* mov rax, f */
+  jByte(0xB8);
+  jPtr(f);
+  jByte(0xFF); /* call rax */
+  jByte(0xD0);
+  for (r = 0; r < PC_REG; r++)
+    jReg(0x8B, HOSTREG(r), r);
+} /* jCall */
+
+/********************************************/
+void jArith(HANDLER op, int d, int s, int t)
+{ /* d = s op t */
+  int x = s, y = t;
+  if ((d != s) && (d == t) && (op != hSUB))
+  { /* commutative */
+    x = t;
+    y = s;
+  }
+  if (d != x)
+  {
+    jMov(RAX, x);
+    x = RAX;
+  }
+  if (op == hADD)
+    jAdd(x, y);
+  else if (op == hSUB)
+    jSub(x, y);
+  else
+    jImul(x, y);
+  if (x != d)
+    jMov(d, RAX);
+} /* jArith */
+
+/********************************************/
+void jInstruction(int loc, DINSTR *di)
+{
+  int r = HOSTREG(di->r), s = HOSTREG(di->s), t = HOSTREG(di->t);
+  long p1, p2;
+  static int cc[] = {CC_L, CC_LE, CC_G, CC_GE, CC_E, CC_NE};
+  switch (di->op)
+  {
+  case hHALT:
+    jExit(loc + 1, srHALT);
+    break;
+  case hIN:
+    jByte(0x48); /* lea rdi, reg[r] */
+    jByte(0x8D);
+    jByte(MODRM(1, 7, RBX));
+    jByte(4 * di->r);
+    jCall((void *)readValue);
+    jTest(RAX);
+    jJcc(CC_E, fixExit, loc + 1, srIN_ERR);
+    break;
+  case hOUT:
+    jMov(7, r); /* edi */
+    jCall((void *)writeValue);
+    break;
+  case hADD:
+  case hSUB:
+  case hMUL:
+    jArith(di->op, r, s, t);
+    break;
+  case hDIV:
+    jTest(t);
+    jJcc(CC_E, fixExit, loc + 1, srZERODIVIDE);
+    jMov(RAX, s);
+    jRex(0, 0, t); /* cmp t, -1 */
+    jByte(0x83);
+    jByte(MODRM(3, 7, t));
+    jByte(0xFF);
+    jByte(0x75); /* jne idiv */
+    p1 = jLen;
+    jByte(0);
+    jByte(0xF7); /* neg eax: INT_MIN / -1 wraps */
+    jByte(MODRM(3, 3, RAX));
+    jByte(0xEB); /* jmp done */
+    p2 = jLen;
+    jByte(0);
+    jBuf[p1] = (unsigned char)(jLen - (p1 + 1));
+    jByte(0x99); /* cdq */
+    jRex(0, 0, t);
+    jByte(0xF7); /* idiv t */
+    jByte(MODRM(3, 7, t));
+    jBuf[p2] = (unsigned char)(jLen - (p2 + 1));
+    jMov(r, RAX);
+    break;
+  case hLD:
+  case hST:
+    if (di->s == ZERO_REG)
+    {
+      if ((di->d >= 0) && (di->d < DADDR_SIZE))
+        jMem((di->op == hLD) ? 0x8B : 0x89, r, di->d);
+      else
+        jExit(loc + 1, srDMEM_ERR);
+      break;
+    }
+    jLea(RAX, s, di->d);
+    jByte(0x3D); /* cmp eax, DADDR_SIZE */
+    jInt(DADDR_SIZE);
+    jJcc(CC_AE, fixExit, loc + 1, srDMEM_ERR);
+    jMemEax((di->op == hLD) ? 0x8B : 0x89, r);
+    break;
+  case hLDA:
+    if (di->s == ZERO_REG)
+      jMovI(r, di->d);
+    else
+      jLea(r, s, di->d);
+    break;
+  case hLDC:
+    jMovI(r, di->d);
+    break;
+  case hJLT:
+  case hJLE:
+  case hJGT:
+  case hJGE:
+  case hJEQ:
+  case hJNE:
+    jTest(r);
+    jJcc(cc[di->op - hJLT], fixLabel, di->d, 0);
+    break;
+  case hGOTO:
+    jJmp(fixLabel, di->d, 0);
+    break;
+  case hJUMP:
+    if (di->s == ZERO_REG)
+      jMovI(RAX, di->d);
+    else
+      jLea(RAX, s, di->d);
+    jByte(0x3D); /* cmp eax, iMemSize */
+    jInt(iMemSize);
+    jJcc(CC_AE, fixExitEax, 0, 0);
+    jByte(0x48); /* mov rcx, jTable */
+    jByte(0xB9);
+    jPtr(jTable);
+    jByte(0xFF); /* jmp [rcx + rax*8] */
+    jByte(MODRM(0, 4, 4));
+    jByte(0xC0 | (RAX << 3) | RCX);
+    break;
+  default: /* hSLOW */
+    jExit(loc, JIT_STEP);
+    break;
+  }
+} /* jInstruction */
+
+/********************************************/
+int jitCompile(void)
+{ /* TRUE if jEntry can run the program */
+  int loc, i, r;
+  static int saved[] = {RBX, 12, 13, 14, R15};
+  void *mem;
+  if (jEntry != NULL)
+    return TRUE;
+  if (jitFailed)
+    return FALSE;
+  jLabel = (long *)malloc((iMemSize + 1) * sizeof(long));
+  jTable = (void **)malloc((iMemSize + 1) * sizeof(void *));
+  if ((jLabel == NULL) || (jTable == NULL))
+    return !(jitFailed = TRUE);
+  /* entry: jEntry(start) */
+  for (i = 0; i < 5; i++)
+  {
+    jRex(0, 0, saved[i]); /* push */
+    jByte(0x50 + (saved[i] & 7));
+  }
+  jByte(0x48); /* mov rbx, reg */
+  jByte(0xBB);
+  jPtr(reg);
+  jByte(0x49); /* mov r15, dMem */
+  jByte(0xBF);
+  jPtr(dMem);
+  for (r = 0; r < PC_REG; r++)
+    jReg(0x8B, HOSTREG(r), r);
+  jByte(0xFF); /* jmp rdi */
+  jByte(0xE7);
+  /* epilogue */
+  jEpilogue = jLen;
+  for (r = 0; r < PC_REG; r++)
+    jReg(0x89, HOSTREG(r), r);
+  for (i = 4; i >= 0; i--)
+  {
+    jRex(0, 0, saved[i]); /* pop */
+    jByte(0x58 + (saved[i] & 7));
+  }
+  jByte(0xC3);
+  for (loc = 0; loc < iMemSize; loc++)
+  {
+    DINSTR di;
+    jLabel[loc] = jLen;
+    di.op = decodeOp(loc, &di);
+    jInstruction(loc, &di);
+  }
+  jLabel[iMemSize] = jLen; /* past the program: stepTM */
+  jExit(iMemSize, JIT_STEP);
+  for (i = 0; i < numFix; i++)
+    if (jFix[i].kind == fixLabel)
+      jPatch(jFix[i].pos, jLabel[jFix[i].loc]);
+    else
+    {
+      jPatch(jFix[i].pos, jLen);
+      if (jFix[i].kind == fixExit)
+        jExit(jFix[i].loc, jFix[i].code);
+      else
+      {
+        jByte(0x89); /* mov reg[PC_REG], eax */
+        jByte(MODRM(1, RAX, RBX));
+        jByte(4 * PC_REG);
+        jMovI(RAX, JIT_STEP);
+        jByte(0xE9);
+        jInt((int)(jEpilogue - (jLen + 4)));
+      }
+    }
+  free(jFix);
+  jFix = NULL;
+  if (jitFailed)
+    return FALSE;
+  mem = mmap(NULL, (size_t)jLen, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    return !(jitFailed = TRUE);
+  memcpy(mem, jBuf, (size_t)jLen);
+  if (mprotect(mem, (size_t)jLen, PROT_READ | PROT_EXEC) != 0)
+  {
+    munmap(mem, (size_t)jLen);
+    return !(jitFailed = TRUE);
+  }
+  for (loc = 0; loc <= iMemSize; loc++)
+    jTable[loc] = (unsigned char *)mem + jLabel[loc];
+  jEntry = (JITENTRY)mem;
+  free(jBuf);
+  free(jLabel);
+  jBuf = NULL;
+  jLabel = NULL;
+  return TRUE;
+} /* jitCompile */
+
+#endif
+
+/********************************************/
+STEPRESULT runJIT(void)
+{ /* as runTM, on native code when it can be
+     compiled; instructions per run are not
+     counted */
+  long count = 0;
+#if USE_JIT
+  int pc, code;
+  STEPRESULT result;
+  if (jitCompile())
+    for (;;)
+    {
+      pc = reg[PC_REG];
+      if ((pc >= 0) && (pc < iMemSize))
+      {
+        code = jEntry(jTable[pc]);
+        if (code == srHALT)
+        {
+          pc = reg[PC_REG] - 1;
+          writeHalt(iMem[pc].iarg1, iMem[pc].iarg2, iMem[pc].iarg3);
+        }
+        if (code != JIT_STEP)
+          return (STEPRESULT)code;
+      }
+      result = stepTM();
+      if (result != srOKAY)
+        return result;
+    }
+#endif
+  return runTM(&count);
+} /* runJIT */
+
+/********************************************/
+/* The translator writes the loaded program  */
+/* as a standalone C program that behaves as */
+/* tm -run: one label per location, reg and  */
+/* dMem as arrays, computed jumps through a  */
+/* switch on the pc and the same faults,     */
+/* messages and exit status. It is made in   */
+/* two passes: the first one only finds the  */
+/* labels and variables that are used        */
+/********************************************/
+
+FILE *cOut;        /* NULL in the first pass */
+char *cUsed;       /* locations that are jump targets */
+int cDispatch;     /* some jump is computed */
+int cUsesM, cUsesV;
+
+/********************************************/
+void cEmit(char *fmt, ...)
+{
+  va_list ap;
+  if (cOut == NULL)
+    return;
+  va_start(ap, fmt);
+  vfprintf(cOut, fmt, ap);
+  va_end(ap);
+} /* cEmit */
+
+/********************************************/
+char *cReg(char *buf, int r, int loc)
+{ /* the value of register r at loc */
+  if (r == PC_REG)
+    sprintf(buf, "%d", loc + 1);
+  else
+    sprintf(buf, "reg[%d]", r);
+  return buf;
+} /* cReg */
+
+/********************************************/
+void cGoto(int target)
+{
+  if ((target >= 0) && (target < iMemSize))
+  {
+    cUsed[target] = TRUE;
+    cEmit("goto L%d;\n", target);
+  }
+  else
+  {
+    cDispatch = TRUE;
+    cEmit("{ pc = %d; goto dispatch; }\n", target);
+  }
+} /* cGoto */
+
+/********************************************/
+void cSet(int r, char *value)
+{ /* reg[r] = value, a computed jump for the pc */
+  if (r == PC_REG)
+  {
+    cDispatch = TRUE;
+    cEmit("{ pc = %s; goto dispatch; }\n", value);
+  }
+  else
+    cEmit("reg[%d] = %s;\n", r, value);
+} /* cSet */
+
+/********************************************/
+int cAddress(INSTRUCTION *in, int loc)
+{ /* m = address of an RM instruction; FALSE if
+     it is a constant out of dMem */
+  char b[32];
+  if (in->iarg3 == PC_REG)
+  {
+    long m = (long)in->iarg2 + loc + 1;
+    if ((m < 0) || (m >= DADDR_SIZE))
+    {
+      cEmit("fault(%d, %d);\n", srDMEM_ERR, loc);
+      return FALSE;
+    }
+    cUsesM = TRUE;
+    cEmit("m = %ld;\n  ", m);
+    return TRUE;
+  }
+  cUsesM = TRUE;
+  cEmit("m = (int)((unsigned)%s + %du);\n  ", cReg(b, in->iarg3, loc), in->iarg2);
+  cEmit("if ((unsigned)m >= %d) fault(%d, %d);\n  ", DADDR_SIZE, srDMEM_ERR, loc);
+  return TRUE;
+} /* cAddress */
+
+/********************************************/
+void cInstruction(int loc)
+{
+  INSTRUCTION *in = &iMem[loc];
+  int r = in->iarg1;
+  char a[32], b[32], v[256];
+  static char *cond[] = {"<", "<=", ">", ">=", "==", "!="};
+  static char *arith[] = {"+", "-", "*"};
+  if (cUsed[loc] || cDispatch)
+    cEmit("L%d:\n", loc);
+  cEmit("  ");
+  switch (in->iop)
+  {
+  case opHALT:
+    cEmit("return 0;\n");
+    break;
+  case opIN:
+    cUsesV = TRUE;
+    cEmit("if (!readInt(&v)) fault(%d, %d);\n  ", srIN_ERR, loc);
+    cSet(r, "v");
+    break;
+  case opOUT:
+    cEmit("printf(\"%%d\\n\", %s);\n", cReg(a, r, loc));
+    break;
+  case opADD:
+  case opSUB:
+  case opMUL:
+    sprintf(v, "(int)((unsigned)%s %s (unsigned)%s)", cReg(a, in->iarg2, loc),
+            arith[in->iop - opADD], cReg(b, in->iarg3, loc));
+    cSet(r, v);
+    break;
+  case opDIV:
+    cReg(a, in->iarg2, loc);
+    cReg(b, in->iarg3, loc);
+    cEmit("if (%s == 0) fault(%d, %d);\n  ", b, srZERODIVIDE, loc);
+    sprintf(v, "(%s == -1) ? (int)(0u - (unsigned)%s) : %s / %s", b, a, a, b);
+    cSet(r, v);
+    break;
+  case opLD:
+    if (cAddress(in, loc))
+      cSet(r, "dMem[m]");
+    break;
+  case opST:
+    if (cAddress(in, loc))
+      cEmit("dMem[m] = %s;\n", cReg(a, r, loc));
+    break;
+  case opLDA:
+    if ((r == PC_REG) && (in->iarg3 == PC_REG))
+      cGoto(in->iarg2 + loc + 1);
+    else
+    {
+      sprintf(v, "(int)((unsigned)%s + %du)", cReg(a, in->iarg3, loc), in->iarg2);
+      cSet(r, v);
+    }
+    break;
+  case opLDC:
+    if (r == PC_REG)
+      cGoto(in->iarg2);
+    else
+    {
+      sprintf(v, "%d", in->iarg2);
+      cSet(r, v);
+    }
+    break;
+  default: /* conditional jumps */
+    cEmit("if (%s %s 0) ", cReg(a, r, loc), cond[in->iop - opJLT]);
+    if (in->iarg3 == PC_REG)
+      cGoto(in->iarg2 + loc + 1);
+    else
+    {
+      sprintf(v, "(int)((unsigned)%s + %du)", cReg(b, in->iarg3, loc), in->iarg2);
+      cSet(PC_REG, v);
+    }
+    break;
+  }
+} /* cInstruction */
+
+/* the fault handler of the translation, as
+   the end of tm -run */
+char *cPrelude =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <ctype.h>\n\n"
+    "static int dMem[DADDR_SIZE];\n\n"
+    "static void fault(int result, int loc)\n"
+    "{\n"
+    "  static const char *msg[] = {\"OK\", \"Halted\", \"Instruction Memory Fault\",\n"
+    "                              \"Data Memory Fault\", \"Division by 0\",\n"
+    "                              \"No value for IN instruction\"};\n"
+    "  fflush(stdout);\n"
+    "  fprintf(stderr, \"%%s: %%s at location %%d\\n\", PROGRAM, msg[result], loc);\n"
+    "  exit(result);\n"
+    "}\n\n";
+
+/* the reader of IN values, as readInt */
+char *cReader =
+    "static int readInt(int *value)\n"
+    "{\n"
+    "  unsigned int n = 0;\n"
+    "  int c, neg = 0, digits = 0;\n"
+    "  do\n"
+    "    c = getchar();\n"
+    "  while (isspace(c));\n"
+    "  if ((c == '-') || (c == '+'))\n"
+    "  {\n"
+    "    neg = (c == '-');\n"
+    "    c = getchar();\n"
+    "  }\n"
+    "  while (isdigit(c))\n"
+    "  {\n"
+    "    n = n * 10 + (c - '0');\n"
+    "    digits = 1;\n"
+    "    c = getchar();\n"
+    "  }\n"
+    "  if (c != EOF)\n"
+    "    ungetc(c, stdin);\n"
+    "  *value = (int)(neg ? 0u - n : n);\n"
+    "  return digits;\n"
+    "}\n\n";
+
+/********************************************/
+int translate(char *cName)
+{ /* the loaded program into the C file cName */
+  int pass, loc, i;
+  char *p;
+  cUsed = (char *)calloc(iMemSize + 1, 1);
+  if (cUsed == NULL)
+    return FALSE;
+  cDispatch = cUsesM = cUsesV = FALSE;
+  for (pass = 1; pass <= 2; pass++)
+  {
+    cOut = NULL;
+    if (pass == 2)
+    {
+      cOut = fopen(cName, "w");
+      if (cOut == NULL)
+      {
+        printf("Unable to open %s\n", cName);
+        return FALSE;
+      }
+      cEmit("/* %s translated to C by the TM simulator */\n\n", pgmName);
+      cEmit("#define PROGRAM \"");
+      for (p = pgmName; *p != '\0'; p++)
+        cEmit((*p == '"') || (*p == '\\') ? "\\%c" : "%c", *p);
+      cEmit("\"\n#define DADDR_SIZE %d\n", DADDR_SIZE);
+      cEmit(cPrelude);
+      if (cUsesV)
+        cEmit(cReader);
+      cEmit("int main(void)\n{\n  int reg[%d] = {0};\n", PC_REG);
+      if (cDispatch)
+        cEmit("  int pc;\n");
+      if (cUsesM)
+        cEmit("  int m;\n");
+      if (cUsesV)
+        cEmit("  int v;\n");
+      cEmit("  static char buf[65536];\n"
+            "  setvbuf(stdout, buf, _IOFBF, sizeof(buf));\n"
+            "  dMem[0] = DADDR_SIZE - 1;\n");
+      for (i = 0; i < numData; i++)
+        cEmit("  dMem[%d] = %d;\n", getInt(objData + i * TMB_DATASIZE),
+              getInt(objData + i * TMB_DATASIZE + 4));
+    }
+    for (loc = 0; loc < iMemSize; loc++)
+      cInstruction(loc);
+    /* past the program */
+    if (iMemSize < IADDR_SIZE)
+      cEmit("  return 0;\n");
+    else
+      cEmit("  fault(%d, %d);\n  return 0;\n", srIMEM_ERR, IADDR_SIZE);
+  }
+  if (cDispatch)
+  {
+    cEmit("dispatch:\n  switch (pc)\n  {\n");
+    for (loc = 0; loc < iMemSize; loc++)
+      cEmit("  case %d: goto L%d;\n", loc, loc);
+    cEmit("  }\n"
+          "  if ((pc < 0) || (pc >= %d))\n"
+          "    fault(%d, pc);\n"
+          "  return 0; /* past the program: HALT */\n",
+          IADDR_SIZE, srIMEM_ERR);
+  }
+  cEmit("}\n");
+  fclose(cOut);
+  free(cUsed);
+  return TRUE;
+} /* translate */
+
 /********************************************/
 int doCommand(void)
 {
@@ -477,15 +1807,12 @@ int doCommand(void)
   int stepcnt = 0, i;
   int printcnt;
   int stepResult;
-  int regNo, loc;
   do
   {
     printf("Enter command: ");
-    fflush(stdin);
     fflush(stdout);
-    gets(in_Line);
-    lineLen = strlen(in_Line);
-    inCol = 0;
+    if (!readLine())
+      return FALSE; /* end of input: quit */
   } while (!getWord());
 
   cmd = word[0];
@@ -610,11 +1937,7 @@ int doCommand(void)
     iloc = 0;
     dloc = 0;
     stepcnt = 0;
-    for (regNo = 0; regNo < NO_REGS; regNo++)
-      reg[regNo] = 0;
-    dMem[0] = DADDR_SIZE - 1;
-    for (loc = 1; loc < DADDR_SIZE; loc++)
-      dMem[loc] = 0;
+    clearMachine();
     break;
 
   case 'q':
@@ -629,17 +1952,21 @@ int doCommand(void)
   {
     if (cmd == 'g')
     {
-      stepcnt = 0;
-      while (stepResult == srOKAY)
-      {
-        iloc = reg[PC_REG];
-        if (traceflag)
+      long count = 0;
+      if (traceflag)
+        while (stepResult == srOKAY)
+        {
+          iloc = reg[PC_REG];
           writeInstruction(iloc);
-        stepResult = stepTM();
-        stepcnt++;
-      }
+          stepResult = stepTM();
+          count++;
+        }
+      else if (jitflag && !icountflag)
+        stepResult = runJIT();
+      else
+        stepResult = runTM(&count);
       if (icountflag)
-        printf("Number of instructions executed = %d\n", stepcnt);
+        printf("Number of instructions executed = %ld\n", count);
     }
     else
     {
@@ -661,26 +1988,82 @@ int doCommand(void)
 /* E X E C U T I O N   B E G I N S   H E R E */
 /********************************************/
 
+/* OUTBUFSIZE is the size of the stdout buffer in
+   batch mode, where OUT values are only written out
+   when it fills or when the program stops */
+#define OUTBUFSIZE (64 * 1024)
+
 int main(int argc, char *argv[])
 {
-  if (argc != 2)
+  char magic[4];
+  int binary, i, toC = FALSE;
+  for (i = 1; (i < argc - 1) && (argv[i][0] == '-'); i++)
+    if (strcmp(argv[i], "-run") == 0)
+      batch = TRUE;
+    else if (strcmp(argv[i], "-jit") == 0)
+      jitflag = TRUE;
+    else if (strcmp(argv[i], "-c") == 0)
+      toC = TRUE;
+    else
+      break;
+  if (i != argc - 1)
   {
-    printf("usage: %s <filename>\n", argv[0]);
+    printf("usage: %s [-run] [-jit] [-c] <filename>\n", argv[0]);
+    printf("  -run  execute to HALT: IN values are read from the input,\n"
+           "        OUT values written one per line; the exit status is 0\n"
+           "        at HALT, 2 to 5 on a fault (see STEPRESULT)\n"
+           "  -jit  compile the program to native code to run it\n"
+           "        (x86-64 only; g without trace or count)\n"
+           "  -c    translate the program to C (file name with extension .c),\n"
+           "        a program that runs as with -run\n");
     exit(1);
   }
-  strcpy(pgmName, argv[1]);
+  pgmName = (char *)malloc(strlen(argv[i]) + 4);
+  strcpy(pgmName, argv[i]);
   if (strchr(pgmName, '.') == NULL)
     strcat(pgmName, ".tm");
-  pgm = fopen(pgmName, "r");
+  pgm = fopen(pgmName, "rb");
   if (pgm == NULL)
   {
     printf("file '%s' not found\n", pgmName);
     exit(1);
   }
+  /* a binary object is told apart by its magic */
+  binary = (fread(magic, 1, 4, pgm) == 4) && (memcmp(magic, TMB_MAGIC, 4) == 0);
+  rewind(pgm);
+  if (!binary && ((pgm = freopen(pgmName, "r", pgm)) == NULL))
+  {
+    printf("file '%s' not found\n", pgmName);
+    exit(1);
+  }
 
   /* read the program */
-  if (!readInstructions())
+  if (!(binary ? readObject() : readInstructions()))
     exit(1);
+  if (toC)
+  {
+    char *cName = (char *)malloc(strlen(pgmName) + 3);
+    char *dot;
+    strcpy(cName, pgmName);
+    dot = strrchr(cName, '.');
+    if ((dot != NULL) && (strchr(dot, '/') == NULL))
+      *dot = '\0';
+    strcat(cName, ".c");
+    return translate(cName) ? 0 : 1;
+  }
+  if (batch)
+  {
+    long count = 0;
+    STEPRESULT result;
+    setvbuf(stdout, NULL, _IOFBF, OUTBUFSIZE);
+    result = jitflag ? runJIT() : runTM(&count);
+    fflush(stdout);
+    if (result == srHALT)
+      return 0;
+    fprintf(stderr, "%s: %s at location %d\n", pgmName,
+            stepResultTab[result], reg[PC_REG] - (result != srIMEM_ERR));
+    return result;
+  }
   /* switch input file to terminal */
   /* reset( input ); */
   /* read-eval-print */
@@ -0,0 +1,39 @@
+/****************************************************/
+/* File: tmb.h                                      */
+/* Binary object format of TM programs (.tmb),      */
+/* written by the TINY compiler and loaded by the   */
+/* TM simulator                                     */
+/****************************************************/
+
+#ifndef _TMB_H_
+#define _TMB_H_
+
+/* A .tmb file is made of four parts; every integer
+ * is 32 bits wide and stored little endian
+ *
+ * header: the magic bytes "TMB\032", the version,
+ *         the number of instructions, of data
+ *         words and the size of the debug section
+ * code:   one record of TMB_INSTRSIZE bytes per
+ *         location, from location 0: the opcode,
+ *         r, the base register (or t for RR
+ *         instructions), a zero byte and the
+ *         offset d (or s for RR instructions)
+ * data:   (address, value) pairs stored in the
+ *         data memory before the program starts
+ * debug:  empty, or one NUL-terminated comment
+ *         per instruction
+ *
+ * Opcodes are numbered as in the simulator, where
+ * 7 and 10 only mark the end of the RR and RM
+ * instructions and are never valid
+ */
+
+#define TMB_MAGIC "TMB\032"
+#define TMB_VERSION 1
+
+#define TMB_HEADERSIZE 20
+#define TMB_INSTRSIZE 8
+#define TMB_DATASIZE 8
+
+#endif
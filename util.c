@@ -8,6 +8,8 @@
 
 #include "globals.h"
 #include "util.h"
+#include "intern.h"
+#include "arena.h"
 
 /* Procedure printToken prints a token
  * and its lexeme to the listing file
@@ -16,19 +18,8 @@ void printToken(TokenType token, const char *tokenString)
 {
   switch (token)
   {
-  case IF:
-  case THEN:
-  case ELSE:
-  case ENDIF:
-  case REPEAT:
-  case UNTIL:
-  case READ:
-  case SWITCH:
-  case CASE:
-  case ENDSWITCH:
-  case WHILE:
-  case ENDWHILE:
-  case WRITE:
+#define RESERVED_LABEL(tok, str, c0, c1, cn) case tok:
+    RESERVED_WORDS(RESERVED_LABEL)
     fprintf(listing,
             "reserved word: %s\n", tokenString);
     break;
@@ -79,12 +70,23 @@ void printToken(TokenType token, const char *tokenString)
   }
 }
 
+/* número de nós criados desde o início da compilação */
+static long nodesCreated = 0;
+
+/* Function treeNodeCount returns the number of
+ * syntax tree nodes created so far
+ */
+long treeNodeCount(void)
+{
+  return nodesCreated;
+}
+
 /*
   Cria e retorna um nó de sentença
 */
 TreeNode *newStmtNode(StmtKind kind)
 {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode)); // aloca memória para um nó
+  TreeNode *t = (TreeNode *)arenaAlloc(sizeof(TreeNode)); // aloca memória para um nó na arena
   int i;
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
@@ -93,9 +95,12 @@ TreeNode *newStmtNode(StmtKind kind)
     for (i = 0; i < MAXCHILDREN; i++)
       t->child[i] = NULL;
     t->sibling = NULL;
+    nodesCreated++;
     t->nodekind = StmtK;
     t->kind.stmt = kind;
     t->lineno = lineno;
+    t->memloc = -1;
+    t->regs = 0;
   }
   return t;
 }
@@ -105,7 +110,7 @@ TreeNode *newStmtNode(StmtKind kind)
 */
 TreeNode *newExpNode(ExpKind kind)
 {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+  TreeNode *t = (TreeNode *)arenaAlloc(sizeof(TreeNode));
   int i;
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
@@ -114,16 +119,19 @@ TreeNode *newExpNode(ExpKind kind)
     for (i = 0; i < MAXCHILDREN; i++)
       t->child[i] = NULL;
     t->sibling = NULL;
+    nodesCreated++;
     t->nodekind = ExpK;
     t->kind.exp = kind;
     t->lineno = lineno;
+    t->memloc = -1;
+    t->regs = 0;
     t->type = Void;
   }
   return t;
 }
 
-/* Function copyString allocates and makes a new
- * copy of an existing string
+/* Function copyString allocates (in the arena)
+ * and makes a new copy of an existing string
  */
 char *copyString(char *s)
 {
@@ -132,7 +140,7 @@ char *copyString(char *s)
   if (s == NULL)
     return NULL;
   n = strlen(s) + 1;
-  t = malloc(n);
+  t = (char *)arenaAlloc(n);
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
   else
@@ -140,6 +148,66 @@ char *copyString(char *s)
   return t;
 }
 
+/* Frame of the traversal stack: a node whose
+ * preProc was applied and the next child to visit
+ */
+typedef struct
+{
+  TreeNode *node;
+  int child;
+} TraverseFrame;
+
+/* Procedure traverseTree is a generic syntax tree
+ * traversal: it applies preProc in preorder and
+ * postProc in postorder to the tree t, without
+ * recursion
+ */
+void traverseTree(TreeNode *t,
+                  void (*preProc)(TreeNode *),
+                  void (*postProc)(TreeNode *))
+{
+  int size = 64;
+  int sp = 0;
+  TraverseFrame *stack = (TraverseFrame *)malloc(size * sizeof(TraverseFrame));
+  if (stack == NULL)
+  {
+    fprintf(listing, "Out of memory error traversing syntax tree\n");
+    return;
+  }
+  for (;;)
+  {
+    if (t != NULL)
+    { /* enter t: preorder action, then its children */
+      preProc(t);
+      if (sp == size)
+      {
+        TraverseFrame *s = (TraverseFrame *)realloc(stack, 2 * size * sizeof(TraverseFrame));
+        if (s == NULL)
+        {
+          fprintf(listing, "Out of memory error traversing syntax tree\n");
+          break;
+        }
+        stack = s;
+        size *= 2;
+      }
+      stack[sp].node = t;
+      stack[sp].child = 0;
+      sp++;
+    }
+    if (sp == 0)
+      break;
+    if (stack[sp - 1].child < MAXCHILDREN)
+      t = stack[sp - 1].node->child[stack[sp - 1].child++];
+    else
+    { /* all children done: postorder action, then the sibling */
+      t = stack[--sp].node;
+      postProc(t);
+      t = t->sibling;
+    }
+  }
+  free(stack);
+} /* traverseTree */
+
 /* Variable indentno is used by printTree to
  * store current number of spaces to indent
  */
@@ -157,73 +225,79 @@ static void printSpaces(void)
     fprintf(listing, " ");
 }
 
-/* procedure printTree prints a syntax tree to the
- * listing file using indentation to indicate subtrees
+/* printNode prints one node of the syntax tree,
+ * indented one level deeper than its parent
  */
-void printTree(TreeNode *tree)
+static void printNode(TreeNode *tree)
 {
-  int i;
   INDENT;
-  while (tree != NULL)
+  printSpaces();
+  if (tree->nodekind == StmtK)
   {
-    printSpaces();
-    if (tree->nodekind == StmtK)
+    switch (tree->kind.stmt)
     {
-      switch (tree->kind.stmt)
-      {
-      case IfK:
-        fprintf(listing, "If\n");
-        break;
-      case RepeatK:
-        fprintf(listing, "Repeat\n");
-        break;
-      case WhileK:
-        fprintf(listing, "While\n");
-        break;
-      case AssignK:
-        fprintf(listing, "Assign to: %s\n", tree->attr.name);
-        break;
-      case ReadK:
-        fprintf(listing, "Read: %s\n", tree->attr.name);
-        break;
-      case WriteK:
-        fprintf(listing, "Write\n");
-        break;
-      case SwitchK:
-        fprintf(listing, "Switch\n");
-        break;
-      case CaseK:
-        fprintf(listing, "Case\n");
-        break;
-      default:
-        fprintf(listing, "Unknown ExpNode kind\n");
-        break;
-      }
+    case IfK:
+      fprintf(listing, "If\n");
+      break;
+    case RepeatK:
+      fprintf(listing, "Repeat\n");
+      break;
+    case WhileK:
+      fprintf(listing, "While\n");
+      break;
+    case AssignK:
+      fprintf(listing, "Assign to: %s\n", atomName(tree->attr.atom));
+      break;
+    case ReadK:
+      fprintf(listing, "Read: %s\n", atomName(tree->attr.atom));
+      break;
+    case WriteK:
+      fprintf(listing, "Write\n");
+      break;
+    case SwitchK:
+      fprintf(listing, "Switch\n");
+      break;
+    case CaseK:
+      fprintf(listing, "Case\n");
+      break;
+    default:
+      fprintf(listing, "Unknown ExpNode kind\n");
+      break;
     }
-    else if (tree->nodekind == ExpK)
+  }
+  else if (tree->nodekind == ExpK)
+  {
+    switch (tree->kind.exp)
     {
-      switch (tree->kind.exp)
-      {
-      case OpK:
-        fprintf(listing, "Op: ");
-        printToken(tree->attr.op, "\0");
-        break;
-      case ConstK:
-        fprintf(listing, "Const: %d\n", tree->attr.val);
-        break;
-      case IdK:
-        fprintf(listing, "Id: %s\n", tree->attr.name);
-        break;
-      default:
-        fprintf(listing, "Unknown ExpNode kind\n");
-        break;
-      }
+    case OpK:
+      fprintf(listing, "Op: ");
+      printToken(tree->attr.op, "\0");
+      break;
+    case ConstK:
+      fprintf(listing, "Const: %d\n", tree->attr.val);
+      break;
+    case IdK:
+      fprintf(listing, "Id: %s\n", atomName(tree->attr.atom));
+      break;
+    default:
+      fprintf(listing, "Unknown ExpNode kind\n");
+      break;
     }
-    else
-      fprintf(listing, "Unknown node kind\n");
-    for (i = 0; i < MAXCHILDREN; i++)
-      printTree(tree->child[i]);
-    tree = tree->sibling;
   }
+  else
+    fprintf(listing, "Unknown node kind\n");
+}
+
+/* unindents after the children of a node */
+static void unindentNode(TreeNode *tree)
+{
   UNINDENT;
 }
+
+/* procedure printTree prints a syntax tree to the
+ * listing file using indentation to indicate subtrees
+ */
+void printTree(TreeNode *tree)
+{
+  traverseTree(tree, printNode, unindentNode);
+}
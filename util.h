@@ -14,7 +14,8 @@
 void printToken( TokenType, const char* );
 
 /* Function newStmtNode creates a new statement
- * node for syntax tree construction
+ * node for syntax tree construction; nodes are
+ * owned by the arena (see arena.h)
  */
 TreeNode * newStmtNode(StmtKind);
 
@@ -23,11 +24,27 @@ TreeNode * newStmtNode(StmtKind);
  */
 TreeNode * newExpNode(ExpKind);
 
-/* Function copyString allocates and makes a new
- * copy of an existing string
+/* Function treeNodeCount returns the number of
+ * syntax tree nodes created so far
+ */
+long treeNodeCount(void);
+
+/* Function copyString allocates (in the arena)
+ * and makes a new copy of an existing string
  */
 char * copyString( char * );
 
+/* Procedure traverseTree is a generic syntax tree
+ * traversal: it applies preProc in preorder and
+ * postProc in postorder to the tree t. Children
+ * are visited through an explicit heap-allocated
+ * stack and siblings by iteration, so C stack
+ * usage is constant whatever the tree size
+ */
+void traverseTree( TreeNode * t,
+                   void (* preProc) (TreeNode *),
+                   void (* postProc) (TreeNode *) );
+
 /* procedure printTree prints a syntax tree to the 
  * listing file using indentation to indicate subtrees
  */